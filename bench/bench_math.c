@@ -0,0 +1,408 @@
+// Microbenchmarks for the vector and matrix routines on the physics hot paths.
+// Every kernel runs over large input arrays and stores its results, the outputs
+// are folded into a volatile sink afterwards so nothing can be optimized away.
+//
+// Usage: kinesis_bench_math [--count N] [--repeats N] [--filter TEXT] [--out PATH]
+
+#include "math_batch.h"
+#include "math_ops.h"
+#include "math_simd.h"
+#include "matrix.h"
+#include "vector.h"
+#include "win32_time.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef void (*KernelFunction)(const int count);
+
+typedef struct {
+	const char* name;
+	KernelFunction run;
+} Kernel;
+
+typedef struct {
+	const char* name;
+	double ns_per_op;
+} KernelResult;
+
+int NUM_ELEMENTS = 1 << 14;
+
+Vec3* VEC3_INPUTS_A;
+Vec3* VEC3_INPUTS_B;
+Vec4* VEC4_INPUTS;
+Mat3* MAT3_INPUTS_A;
+Mat3* MAT3_INPUTS_B;
+Mat4* MAT4_INPUTS_A;
+Mat4* MAT4_INPUTS_B;
+float* ANGLE_INPUTS;
+
+enum { BOX_AXES = 15 };
+Vec3 BOX_AXIS_INPUTS[BOX_AXES];
+
+Vec3* VEC3_OUTPUTS;
+Vec4* VEC4_OUTPUTS;
+Mat3* MAT3_OUTPUTS;
+Mat4* MAT4_OUTPUTS;
+float* FLOAT_OUTPUTS;
+
+volatile float SINK;
+
+uint32_t RANDOM_STATE = 1;
+
+float random_float(const float min, const float max) {
+	RANDOM_STATE = RANDOM_STATE * 1664525u + 1013904223u;
+	return min + (max - min) * (float)(RANDOM_STATE >> 8) / (float)(1 << 24);
+}
+
+void fill_floats(float* const values, const int count) {
+	for (int i = 0; i < count; i++) {
+		values[i] = random_float(-2, 2);
+	}
+}
+
+void* allocate(const size_t size) {
+	void* const memory = malloc(size);
+	if (!memory) {
+		printf("Out of memory\n");
+		exit(1);
+	}
+	return memory;
+}
+
+void init_inputs(const int count) {
+	VEC3_INPUTS_A = (Vec3*)allocate(count * sizeof(Vec3));
+	VEC3_INPUTS_B = (Vec3*)allocate(count * sizeof(Vec3));
+	VEC4_INPUTS = (Vec4*)allocate(count * sizeof(Vec4));
+	MAT3_INPUTS_A = (Mat3*)allocate(count * sizeof(Mat3));
+	MAT3_INPUTS_B = (Mat3*)allocate(count * sizeof(Mat3));
+	MAT4_INPUTS_A = (Mat4*)allocate(count * sizeof(Mat4));
+	MAT4_INPUTS_B = (Mat4*)allocate(count * sizeof(Mat4));
+	ANGLE_INPUTS = (float*)allocate(count * sizeof(float));
+
+	VEC3_OUTPUTS = (Vec3*)allocate(count * sizeof(Vec3));
+	VEC4_OUTPUTS = (Vec4*)allocate(count * sizeof(Vec4));
+	MAT3_OUTPUTS = (Mat3*)allocate(count * sizeof(Mat3));
+	MAT4_OUTPUTS = (Mat4*)allocate(count * sizeof(Mat4));
+	FLOAT_OUTPUTS = (float*)allocate(count * sizeof(float));
+
+	fill_floats((float*)VEC3_INPUTS_A, count * 3);
+	fill_floats((float*)VEC3_INPUTS_B, count * 3);
+	fill_floats((float*)VEC4_INPUTS, count * 4);
+	fill_floats((float*)MAT3_INPUTS_A, count * 9);
+	fill_floats((float*)MAT3_INPUTS_B, count * 9);
+	fill_floats((float*)MAT4_INPUTS_A, count * 16);
+	fill_floats((float*)MAT4_INPUTS_B, count * 16);
+
+	for (int i = 0; i < count; i++) {
+		ANGLE_INPUTS[i] = random_float(0, 360);
+	}
+
+	fill_floats((float*)BOX_AXIS_INPUTS, BOX_AXES * 3);
+}
+
+// Folds every output into the sink so the stores are observable
+void consume_outputs(const int count) {
+	float sum = 0;
+	for (int i = 0; i < count; i++) {
+		sum += VEC3_OUTPUTS[i].x + VEC4_OUTPUTS[i].w + MAT3_OUTPUTS[i].m[2][2] + MAT4_OUTPUTS[i].m[3][3] + FLOAT_OUTPUTS[i];
+	}
+	SINK = sum;
+}
+
+// Kernels using the current pass-by-value API
+
+void kernel_mat4_mul(const int count) {
+	for (int i = 0; i < count; i++) {
+		MAT4_OUTPUTS[i] = mat4_mul(MAT4_INPUTS_A[i], MAT4_INPUTS_B[i]);
+	}
+}
+
+void kernel_mat3_mul(const int count) {
+	for (int i = 0; i < count; i++) {
+		MAT3_OUTPUTS[i] = mat3_mul(&MAT3_INPUTS_A[i], &MAT3_INPUTS_B[i]);
+	}
+}
+
+void kernel_vec4_mul_mat4(const int count) {
+	for (int i = 0; i < count; i++) {
+		VEC4_OUTPUTS[i] = vec4_mul_mat4(VEC4_INPUTS[i], &MAT4_INPUTS_A[i]);
+	}
+}
+
+void kernel_vec3_mul_mat4(const int count) {
+	for (int i = 0; i < count; i++) {
+		VEC3_OUTPUTS[i] = vec3_mul_mat4(VEC3_INPUTS_A[i], &MAT4_INPUTS_A[i]);
+	}
+}
+
+void kernel_vec3_mul_mat3(const int count) {
+	for (int i = 0; i < count; i++) {
+		VEC3_OUTPUTS[i] = vec3_mul_mat3(VEC3_INPUTS_A[i], &MAT3_INPUTS_A[i]);
+	}
+}
+
+void kernel_mat3_inverse(const int count) {
+	for (int i = 0; i < count; i++) {
+		MAT3_OUTPUTS[i] = mat3_inverse(&MAT3_INPUTS_A[i]);
+	}
+}
+
+void kernel_mat3_rotate(const int count) {
+	for (int i = 0; i < count; i++) {
+		MAT3_OUTPUTS[i] = mat3_rotate(&MAT3_INPUTS_A[i], ANGLE_INPUTS[i], VEC3_INPUTS_A[i]);
+	}
+}
+
+void kernel_mat4_rotate(const int count) {
+	for (int i = 0; i < count; i++) {
+		MAT4_OUTPUTS[i] = mat4_rotate(MAT4_INPUTS_A[i], ANGLE_INPUTS[i], VEC3_INPUTS_A[i]);
+	}
+}
+
+void kernel_vec3_normalize(const int count) {
+	for (int i = 0; i < count; i++) {
+		VEC3_OUTPUTS[i] = vec3_normalize(VEC3_INPUTS_A[i]);
+	}
+}
+
+void kernel_vec3_cross(const int count) {
+	for (int i = 0; i < count; i++) {
+		VEC3_OUTPUTS[i] = vec3_cross(VEC3_INPUTS_A[i], VEC3_INPUTS_B[i]);
+	}
+}
+
+void kernel_vec3_dot(const int count) {
+	for (int i = 0; i < count; i++) {
+		FLOAT_OUTPUTS[i] = vec3_dot(VEC3_INPUTS_A[i], VEC3_INPUTS_B[i]);
+	}
+}
+
+void kernel_vec3_add(const int count) {
+	for (int i = 0; i < count; i++) {
+		VEC3_OUTPUTS[i] = vec3_add(VEC3_INPUTS_A[i], VEC3_INPUTS_B[i]);
+	}
+}
+
+// Reference variants written in this file, showing what the call boundary and
+// the by-value matrix copies cost compared to the library routines above
+
+static inline void mat4_mul_reference(Mat4* const result, const Mat4* const a, const Mat4* const b) {
+	Mat4 product;
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			product.m[i][j] = a->m[i][0] * b->m[0][j] + a->m[i][1] * b->m[1][j] + a->m[i][2] * b->m[2][j] + a->m[i][3] * b->m[3][j];
+		}
+	}
+	*result = product;
+}
+
+void kernel_mat4_mul_reference(const int count) {
+	for (int i = 0; i < count; i++) {
+		mat4_mul_reference(&MAT4_OUTPUTS[i], &MAT4_INPUTS_A[i], &MAT4_INPUTS_B[i]);
+	}
+}
+
+void kernel_mat4_mul_into(const int count) {
+	for (int i = 0; i < count; i++) {
+		mat4_mul_into(&MAT4_OUTPUTS[i], &MAT4_INPUTS_A[i], &MAT4_INPUTS_B[i]);
+	}
+}
+
+void kernel_vec3_cross_reference(const int count) {
+	for (int i = 0; i < count; i++) {
+		const Vec3 a = VEC3_INPUTS_A[i];
+		const Vec3 b = VEC3_INPUTS_B[i];
+		VEC3_OUTPUTS[i] = (Vec3){ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+}
+
+// Box narrowphase shape: 8 corners transformed, then projected onto 15 axes.
+// Per-point kernels against the batched SoA kernels, one box per element.
+
+static const Vec3 BOX_CORNERS[8] = {
+	{ 0.5f, -0.5f, -0.5f }, { -0.5f, -0.5f, -0.5f }, { -0.5f, -0.5f, 0.5f }, { 0.5f, -0.5f, 0.5f },
+	{ 0.5f, 0.5f, -0.5f }, { -0.5f, 0.5f, -0.5f }, { -0.5f, 0.5f, 0.5f }, { 0.5f, 0.5f, 0.5f }
+};
+
+
+void kernel_box_project_per_point(const int count) {
+	for (int i = 0; i < count; i++) {
+		const Vec3* const axes = BOX_AXIS_INPUTS;
+		float sum = 0;
+
+		for (int axis = 0; axis < BOX_AXES; axis++) {
+			float min = 1e30f;
+			float max = -1e30f;
+			for (int corner = 0; corner < 8; corner++) {
+				const Vec4 world_point = vec4_mul_mat4(vec3_to_vec4(BOX_CORNERS[corner]), &MAT4_INPUTS_A[i]);
+				const float projection = vec3_dot(vec4_to_vec3(world_point), axes[axis]);
+				min = projection < min ? projection : min;
+				max = projection > max ? projection : max;
+			}
+			sum += max - min;
+		}
+
+		FLOAT_OUTPUTS[i] = sum;
+	}
+}
+
+void kernel_box_project_batched(const int count) {
+	for (int i = 0; i < count; i++) {
+		const Vec3* const axes = BOX_AXIS_INPUTS;
+		float corners_x[8], corners_y[8], corners_z[8];
+		const PointsSoA corners = { corners_x, corners_y, corners_z };
+		float mins[BOX_AXES], maxs[BOX_AXES];
+
+		points_transform(corners, BOX_CORNERS, 8, &MAT4_INPUTS_A[i]);
+		points_project(corners, 8, axes, BOX_AXES, mins, maxs);
+
+		float sum = 0;
+		for (int axis = 0; axis < BOX_AXES; axis++) {
+			sum += maxs[axis] - mins[axis];
+		}
+
+		FLOAT_OUTPUTS[i] = sum;
+	}
+}
+
+void kernel_points_transform(const int count) {
+	const PointsSoA out = { (float*)VEC4_OUTPUTS, (float*)VEC4_OUTPUTS + count, (float*)VEC4_OUTPUTS + 2 * count };
+	points_transform(out, VEC3_INPUTS_A, count, &MAT4_INPUTS_A[0]);
+}
+
+#ifdef KINESIS_SIMD_SSE
+// Register API of the SIMD backend, values stay in __m128 between operations
+
+void kernel_mat4x_mul_vec4x(const int count) {
+	for (int i = 0; i < count; i++) {
+		vec4x_store(&VEC4_OUTPUTS[i], mat4x_mul_vec4x(&MAT4_INPUTS_A[i], vec4x_load(&VEC4_INPUTS[i])));
+	}
+}
+
+void kernel_vec4x_cross3(const int count) {
+	for (int i = 0; i < count; i++) {
+		const Vec4x a = vec4x_load(&VEC4_INPUTS[i]);
+		const Vec4x b = vec4x_load(&VEC4_INPUTS[count - 1 - i]);
+		vec4x_store(&VEC4_OUTPUTS[i], vec4x_cross3(a, b));
+	}
+}
+
+void kernel_vec4x_normalize3(const int count) {
+	for (int i = 0; i < count; i++) {
+		vec4x_store(&VEC4_OUTPUTS[i], vec4x_normalize3(vec4x_load(&VEC4_INPUTS[i])));
+	}
+}
+#endif
+
+static const Kernel KERNELS[] = {
+	{ "mat4_mul", kernel_mat4_mul },
+	{ "mat4_mul (inline, by pointer)", kernel_mat4_mul_reference },
+	{ "mat4_mul_into", kernel_mat4_mul_into },
+	{ "mat3_mul", kernel_mat3_mul },
+	{ "vec4_mul_mat4", kernel_vec4_mul_mat4 },
+	{ "vec3_mul_mat4", kernel_vec3_mul_mat4 },
+	{ "vec3_mul_mat3", kernel_vec3_mul_mat3 },
+	{ "mat3_inverse", kernel_mat3_inverse },
+	{ "mat3_rotate", kernel_mat3_rotate },
+	{ "mat4_rotate", kernel_mat4_rotate },
+	{ "vec3_normalize", kernel_vec3_normalize },
+	{ "vec3_cross", kernel_vec3_cross },
+	{ "vec3_cross (inline)", kernel_vec3_cross_reference },
+	{ "vec3_dot", kernel_vec3_dot },
+	{ "vec3_add", kernel_vec3_add },
+	{ "points_transform", kernel_points_transform },
+	{ "box project 8x15 (per point)", kernel_box_project_per_point },
+	{ "box project 8x15 (batched)", kernel_box_project_batched },
+#ifdef KINESIS_SIMD_SSE
+	{ "mat4x_mul_vec4x", kernel_mat4x_mul_vec4x },
+	{ "vec4x_cross3", kernel_vec4x_cross3 },
+	{ "vec4x_normalize3", kernel_vec4x_normalize3 },
+#endif
+};
+
+enum { NUM_KERNELS = sizeof(KERNELS) / sizeof(KERNELS[0]) };
+
+// Best of several timed passes after a warm-up pass, in nanoseconds per element
+double time_kernel(const Kernel* const kernel, const int count, const int repeats) {
+	kernel->run(count);
+
+	double best_ms = 1e30;
+	for (int repeat = 0; repeat < repeats; repeat++) {
+		const double start_ms = get_time_ms();
+		kernel->run(count);
+		const double elapsed_ms = get_time_ms() - start_ms;
+
+		if (elapsed_ms < best_ms) {
+			best_ms = elapsed_ms;
+		}
+	}
+
+	consume_outputs(count);
+
+	return best_ms * 1000000.0 / count;
+}
+
+int main(int argc, char** argv) {
+	int repeats = 20;
+	const char* filter = NULL;
+	const char* out_path = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+			NUM_ELEMENTS = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+			repeats = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+			filter = argv[++i];
+		} else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			out_path = argv[++i];
+		} else {
+			printf("Usage: %s [--count N] [--repeats N] [--filter TEXT] [--out PATH]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (NUM_ELEMENTS <= 0 || repeats <= 0) {
+		printf("--count and --repeats must be positive\n");
+		return 1;
+	}
+
+	init_inputs(NUM_ELEMENTS);
+
+	KernelResult results[NUM_KERNELS];
+	int num_results = 0;
+
+	printf("%-36s %12s %12s\n", "kernel", "ns/op", "Mop/s");
+	for (int i = 0; i < NUM_KERNELS; i++) {
+		const Kernel* const kernel = &KERNELS[i];
+		if (filter && !strstr(kernel->name, filter)) {
+			continue;
+		}
+
+		const double ns_per_op = time_kernel(kernel, NUM_ELEMENTS, repeats);
+		printf("%-36s %12.3f %12.1f\n", kernel->name, ns_per_op, 1000.0 / ns_per_op);
+
+		results[num_results].name = kernel->name;
+		results[num_results].ns_per_op = ns_per_op;
+		num_results++;
+	}
+
+	if (out_path) {
+		FILE* const file = fopen(out_path, "wb");
+		if (!file) {
+			printf("Failed to open %s\n", out_path);
+			return 1;
+		}
+
+		fprintf(file, "{\n  \"count\": %d,\n  \"kernels\": [\n", NUM_ELEMENTS);
+		for (int i = 0; i < num_results; i++) {
+			fprintf(file, "    { \"name\": \"%s\", \"ns_per_op\": %.4f }%s\n", results[i].name, results[i].ns_per_op, i + 1 < num_results ? "," : "");
+		}
+		fprintf(file, "  ]\n}\n");
+		fclose(file);
+	}
+
+	return 0;
+}
@@ -0,0 +1,526 @@
+// Runs canonical scenes for a fixed number of steps and reports step time
+// statistics, the per-phase profile and the final energy as JSON.
+//
+// Usage: kinesis_bench [--steps N] [--scene NAME] [--size N] [--rows M] [--out PATH] [--label TEXT]
+
+#include "physics.h"
+#include "math_ops.h"
+#include "profiler.h"
+#include "stats.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+	SCENE_PYRAMID,
+	SCENE_WALL,
+	SCENE_RAIN,
+	SCENE_PILE,
+	SCENE_PROPS,
+	SCENE_TERRAIN,
+	SCENE_HEIGHTFIELD,
+	SCENE_COMPOUNDS,
+	SCENE_COUNT
+} SceneType;
+
+static const char* const SCENE_NAMES[SCENE_COUNT] = {
+	"pyramid",
+	"wall",
+	"rain",
+	"pile",
+	"props",
+	"terrain",
+	"heightfield",
+	"compounds"
+};
+
+// Default size parameter of each scene, override with --size
+static const int SCENE_DEFAULT_SIZES[SCENE_COUNT] = { 6, 6, 48, 32, 48, 48, 48, 24 };
+
+static const float BOX_SIZE = 5;
+static const float BOX_GAP = 0.05f;
+
+typedef struct {
+	SceneType type;
+	int size;
+	int rows;
+	int num_bodies;
+	int steps;
+
+	double mean_ms;
+	double p50_ms;
+	double p99_ms;
+	double max_ms;
+
+	double phase_ms[PROFILE_ZONE_COUNT];
+
+	float initial_energy;
+	float final_energy;
+
+	uint64_t total_contact_points;
+	uint64_t total_bisection_iterations;
+	uint64_t total_overflows;
+} SceneResult;
+
+// Fixed seed LCG so scenes are identical across runs and platforms
+uint32_t RANDOM_STATE = 1;
+
+float random_float(const float min, const float max) {
+	RANDOM_STATE = RANDOM_STATE * 1664525u + 1013904223u;
+	return min + (max - min) * (float)(RANDOM_STATE >> 8) / (float)(1 << 24);
+}
+
+Mat3 random_orientation() {
+	const Vec3 axis = new_vec3(random_float(-1, 1), random_float(-1, 1), random_float(-1, 1));
+	return mat3_rotate(&MAT3_IDENTITY, random_float(0, 360), axis);
+}
+
+int build_pyramid(const int height) {
+	int count = 0;
+	const float step = BOX_SIZE + BOX_GAP;
+
+	for (int layer = 0; layer < height; layer++) {
+		const int row_count = height - layer;
+		const float start_x = -(row_count - 1) * step / 2;
+		const float y = BOX_SIZE / 2 + layer * step;
+
+		for (int i = 0; i < row_count; i++) {
+			if (add_cube(new_vec3(start_x + i * step, y, 0), MAT3_IDENTITY)) {
+				count++;
+			}
+		}
+	}
+
+	return count;
+}
+
+// width x height wall, staggered like bricks
+int build_wall(const int width, const int height) {
+	int count = 0;
+	const float step = BOX_SIZE + BOX_GAP;
+
+	for (int row = 0; row < height; row++) {
+		const float offset = (row % 2) ? step / 2 : 0;
+		const float start_x = -(width - 1) * step / 2 + offset;
+		const float y = BOX_SIZE / 2 + row * step;
+
+		for (int i = 0; i < width; i++) {
+			if (add_cube(new_vec3(start_x + i * step, y, 0), MAT3_IDENTITY)) {
+				count++;
+			}
+		}
+	}
+
+	return count;
+}
+
+int build_rain(const int num_cubes) {
+	int count = 0;
+	const float extent = 6 * BOX_SIZE;
+
+	for (int i = 0; i < num_cubes; i++) {
+		const Vec3 position = new_vec3(random_float(-extent, extent), random_float(20, 20 + num_cubes * 2.f), random_float(-extent, extent));
+		Cube* const cube = add_cube(position, random_orientation());
+		if (cube) {
+			cube->velocity = new_vec3(random_float(-2, 2), random_float(-5, 0), random_float(-2, 2));
+			count++;
+		}
+	}
+
+	return count;
+}
+
+// Cubes packed into a narrow column so that most of them touch several neighbours
+int build_pile(const int num_cubes) {
+	int count = 0;
+	const float step = BOX_SIZE * 1.1f;
+
+	for (int i = 0; i < num_cubes; i++) {
+		const int layer = i / 4;
+		const Vec3 position = new_vec3(
+			(i & 1) * step + random_float(-0.5f, 0.5f),
+			BOX_SIZE + layer * step,
+			((i >> 1) & 1) * step + random_float(-0.5f, 0.5f));
+
+		if (add_cube(position, random_orientation())) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+// Rock shaped hull shared by the hull props
+ConvexHull PROP_HULL = {};
+
+// Rain of spheres, capsules, boxes and hulls in turn
+int build_props(const int num_bodies) {
+	int count = 0;
+	const float extent = 4 * BOX_SIZE;
+
+	// Points scattered over an ellipsoid
+	enum { PROP_HULL_POINTS = 32 };
+	Vec3 points[PROP_HULL_POINTS];
+	for (int i = 0; i < PROP_HULL_POINTS; i++) {
+		const Vec3 direction = vec3_normalize(new_vec3(random_float(-1, 1), random_float(-1, 1), random_float(-1, 1)));
+		points[i] = vec3_mul(direction, new_vec3(BOX_SIZE / 2, BOX_SIZE / 3, BOX_SIZE / 2));
+	}
+	convex_hull_build(&PROP_HULL, points, PROP_HULL_POINTS);
+
+	for (int i = 0; i < num_bodies; i++) {
+		const Vec3 position = new_vec3(random_float(-extent, extent), random_float(10, 10 + num_bodies * 1.5f), random_float(-extent, extent));
+
+		Cube* body;
+		switch (i % 4) {
+			case 0: body = add_sphere(position, BOX_SIZE / 2, 5); break;
+			case 1: body = add_capsule(position, random_orientation(), BOX_SIZE / 4, BOX_SIZE / 2, 5); break;
+			case 2: body = add_cube(position, random_orientation()); break;
+			default: body = add_hull(position, random_orientation(), &PROP_HULL, 5); break;
+		}
+
+		if (body) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+// Rolling terrain of about a million triangles, built once and shared by every terrain run
+enum { TERRAIN_CELLS = 724 };
+static const float TERRAIN_CELL_SIZE = 4;
+TriangleMesh TERRAIN_MESH = {};
+
+float terrain_height(const float x, const float z) {
+	return 2 * sinf(x * 0.05f) * cosf(z * 0.04f) + 0.5f * sinf((x + z) * 0.13f);
+}
+
+// Props rained onto a triangle mesh instead of the floor
+int build_terrain(const int num_bodies) {
+	if (TERRAIN_MESH.num_triangles == 0) {
+		const int row = TERRAIN_CELLS + 1;
+		Vec3* const vertices = malloc(row * row * sizeof(Vec3));
+		int* const indices = malloc(TERRAIN_CELLS * TERRAIN_CELLS * 6 * sizeof(int));
+		if (!vertices || !indices) {
+			free(vertices);
+			free(indices);
+			return 0;
+		}
+
+		for (int z = 0; z < row; z++) {
+			for (int x = 0; x < row; x++) {
+				const float world_x = (x - TERRAIN_CELLS / 2) * TERRAIN_CELL_SIZE;
+				const float world_z = (z - TERRAIN_CELLS / 2) * TERRAIN_CELL_SIZE;
+				vertices[z * row + x] = new_vec3(world_x, terrain_height(world_x, world_z), world_z);
+			}
+		}
+
+		int* index = indices;
+		for (int z = 0; z < TERRAIN_CELLS; z++) {
+			for (int x = 0; x < TERRAIN_CELLS; x++) {
+				const int corner = z * row + x;
+				*index++ = corner;
+				*index++ = corner + row;
+				*index++ = corner + 1;
+				*index++ = corner + 1;
+				*index++ = corner + row;
+				*index++ = corner + row + 1;
+			}
+		}
+
+		triangle_mesh_build(&TERRAIN_MESH, vertices, indices, TERRAIN_CELLS * TERRAIN_CELLS * 2);
+		free(vertices);
+		free(indices);
+	}
+
+	// Lift the terrain clear of the floor
+	add_mesh(new_vec3(0, 5, 0), MAT3_IDENTITY, &TERRAIN_MESH);
+	return build_props(num_bodies);
+}
+
+// 4k by 4k heightfield of the same terrain, quantized to centimetres
+enum { HEIGHTFIELD_SAMPLES = 4097 };
+static const float HEIGHTFIELD_CELL_SIZE = 4;
+static const float HEIGHTFIELD_SCALE = 0.01f;
+uint16_t* HEIGHTFIELD_HEIGHTS = NULL;
+Heightfield HEIGHTFIELD = {};
+
+// Props rained onto a heightfield
+int build_heightfield(const int num_bodies) {
+	if (!HEIGHTFIELD_HEIGHTS) {
+		HEIGHTFIELD_HEIGHTS = malloc((size_t)HEIGHTFIELD_SAMPLES * HEIGHTFIELD_SAMPLES * sizeof(uint16_t));
+		if (!HEIGHTFIELD_HEIGHTS) {
+			return 0;
+		}
+
+		const float offset = -4;
+		for (int z = 0; z < HEIGHTFIELD_SAMPLES; z++) {
+			for (int x = 0; x < HEIGHTFIELD_SAMPLES; x++) {
+				const float world_x = (x - HEIGHTFIELD_SAMPLES / 2) * HEIGHTFIELD_CELL_SIZE;
+				const float world_z = (z - HEIGHTFIELD_SAMPLES / 2) * HEIGHTFIELD_CELL_SIZE;
+				const float height = terrain_height(world_x, world_z);
+				HEIGHTFIELD_HEIGHTS[(size_t)z * HEIGHTFIELD_SAMPLES + x] = (uint16_t)((height - offset) / HEIGHTFIELD_SCALE + 0.5f);
+			}
+		}
+
+		heightfield_init(&HEIGHTFIELD, HEIGHTFIELD_HEIGHTS, HEIGHTFIELD_SAMPLES, HEIGHTFIELD_SAMPLES, HEIGHTFIELD_CELL_SIZE, HEIGHTFIELD_SCALE, offset);
+	}
+
+	add_heightfield(new_vec3(0, 5, 0), MAT3_IDENTITY, &HEIGHTFIELD);
+	return build_props(num_bodies);
+}
+
+// Tables, dumbbells and rafts of fifty boxes, shared by every compounds run
+enum { RAFT_COLUMNS = 10, RAFT_ROWS = 5 };
+CompoundShape TABLE_SHAPE = {};
+CompoundShape DUMBBELL_SHAPE = {};
+CompoundShape RAFT_SHAPE = {};
+
+// Rain of compound bodies in turn
+int build_compounds(const int num_bodies) {
+	if (TABLE_SHAPE.num_children == 0) {
+		const float leg = BOX_SIZE / 2 - 0.25f;
+		const CompoundChild table[5] = {
+			{ SHAPE_BOX, { { 0, BOX_SIZE / 2, 0 }, MAT3_IDENTITY }, { BOX_SIZE / 2, 0.25f, BOX_SIZE / 2 }, 0, 0, NULL, 3 },
+			{ SHAPE_BOX, { { leg, 0, leg }, MAT3_IDENTITY }, { 0.25f, BOX_SIZE / 2, 0.25f }, 0, 0, NULL, 0.5f },
+			{ SHAPE_BOX, { { -leg, 0, leg }, MAT3_IDENTITY }, { 0.25f, BOX_SIZE / 2, 0.25f }, 0, 0, NULL, 0.5f },
+			{ SHAPE_BOX, { { leg, 0, -leg }, MAT3_IDENTITY }, { 0.25f, BOX_SIZE / 2, 0.25f }, 0, 0, NULL, 0.5f },
+			{ SHAPE_BOX, { { -leg, 0, -leg }, MAT3_IDENTITY }, { 0.25f, BOX_SIZE / 2, 0.25f }, 0, 0, NULL, 0.5f }
+		};
+		compound_shape_build(&TABLE_SHAPE, table, 5);
+
+		const Mat3 horizontal = mat3_rotate(&MAT3_IDENTITY, 90, new_vec3(0, 0, 1));
+		const CompoundChild dumbbell[3] = {
+			{ SHAPE_SPHERE, { { -BOX_SIZE, 0, 0 }, MAT3_IDENTITY }, {}, BOX_SIZE / 4, 0, NULL, 2 },
+			{ SHAPE_SPHERE, { { BOX_SIZE, 0, 0 }, MAT3_IDENTITY }, {}, BOX_SIZE / 4, 0, NULL, 2 },
+			{ SHAPE_CAPSULE, { {}, horizontal }, {}, BOX_SIZE / 10, BOX_SIZE, NULL, 1 }
+		};
+		compound_shape_build(&DUMBBELL_SHAPE, dumbbell, 3);
+
+		CompoundChild raft[RAFT_COLUMNS * RAFT_ROWS];
+		for (int i = 0; i < RAFT_COLUMNS * RAFT_ROWS; i++) {
+			const Vec3 position = new_vec3((i % RAFT_COLUMNS) * 1.0f, 0, (i / RAFT_COLUMNS) * 1.0f);
+			raft[i] = (CompoundChild){ SHAPE_BOX, { position, MAT3_IDENTITY }, { 0.5f, 0.25f, 0.5f }, 0, 0, NULL, 0.2f };
+		}
+		compound_shape_build(&RAFT_SHAPE, raft, RAFT_COLUMNS * RAFT_ROWS);
+	}
+
+	int count = 0;
+	const float extent = 4 * BOX_SIZE;
+	for (int i = 0; i < num_bodies; i++) {
+		const Vec3 position = new_vec3(random_float(-extent, extent), random_float(10, 10 + num_bodies * 3), random_float(-extent, extent));
+		const CompoundShape* const shapes[3] = { &TABLE_SHAPE, &DUMBBELL_SHAPE, &RAFT_SHAPE };
+		if (add_compound(position, random_orientation(), shapes[i % 3])) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+int build_scene(const SceneType type, const int size, const int rows) {
+	physics_reset();
+	RANDOM_STATE = 1;
+
+	switch (type) {
+		case SCENE_PYRAMID: return build_pyramid(size);
+		case SCENE_WALL: return build_wall(size, rows);
+		case SCENE_RAIN: return build_rain(size);
+		case SCENE_PILE: return build_pile(size);
+		case SCENE_PROPS: return build_props(size);
+		case SCENE_TERRAIN: return build_terrain(size);
+		case SCENE_HEIGHTFIELD: return build_heightfield(size);
+		case SCENE_COMPOUNDS: return build_compounds(size);
+		default: return 0;
+	}
+}
+
+int compare_doubles(const void* a, const void* b) {
+	const double x = *(const double*)a;
+	const double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+double percentile(const double* const sorted, const int count, const double fraction) {
+	int index = (int)(fraction * (count - 1) + 0.5);
+	if (index >= count) {
+		index = count - 1;
+	}
+	return sorted[index];
+}
+
+SceneResult run_scene(const SceneType type, const int size, const int rows, const int steps) {
+	SceneResult result = {};
+	result.type = type;
+	result.size = size;
+	result.rows = rows;
+	result.steps = steps;
+	result.num_bodies = build_scene(type, size, rows);
+	result.initial_energy = physics_total_energy();
+
+	double* const step_times = (double*)malloc(steps * sizeof(double));
+
+	profiler_reset();
+
+	double total_ms = 0;
+	for (int step = 0; step < steps; step++) {
+		physics_step();
+
+		const SimStats* const stats = stats_get();
+		step_times[step] = stats->step_time_ms;
+		total_ms += stats->step_time_ms;
+
+		result.total_contact_points += stats->contact_points;
+		result.total_bisection_iterations += stats->bisection_iterations;
+		result.total_overflows += stats->contact_pool_overflows + stats->manifold_overflows + stats->contact_event_overflows;
+	}
+
+	for (int zone = 0; zone < PROFILE_ZONE_COUNT; zone++) {
+		result.phase_ms[zone] = profiler_get_zone_stats((ProfileZone)zone).total_ms / steps;
+	}
+
+	qsort(step_times, steps, sizeof(double), compare_doubles);
+	result.mean_ms = total_ms / steps;
+	result.p50_ms = percentile(step_times, steps, 0.5);
+	result.p99_ms = percentile(step_times, steps, 0.99);
+	result.max_ms = step_times[steps - 1];
+	result.final_energy = physics_total_energy();
+
+	free(step_times);
+
+	return result;
+}
+
+void write_results_json(FILE* const file, const char* const label, const SceneResult* const results, const int count) {
+	fprintf(file, "{\n");
+	fprintf(file, "  \"label\": \"%s\",\n", label);
+	fprintf(file, "  \"delta_time\": %.9f,\n", DELTA_TIME);
+	fprintf(file, "  \"scenes\": [\n");
+
+	for (int i = 0; i < count; i++) {
+		const SceneResult* const result = &results[i];
+
+		fprintf(file, "    {\n");
+		fprintf(file, "      \"name\": \"%s\",\n", SCENE_NAMES[result->type]);
+		fprintf(file, "      \"size\": %d,\n", result->size);
+		fprintf(file, "      \"rows\": %d,\n", result->rows);
+		fprintf(file, "      \"bodies\": %d,\n", result->num_bodies);
+		fprintf(file, "      \"steps\": %d,\n", result->steps);
+		fprintf(file, "      \"mean_ms\": %.6f,\n", result->mean_ms);
+		fprintf(file, "      \"p50_ms\": %.6f,\n", result->p50_ms);
+		fprintf(file, "      \"p99_ms\": %.6f,\n", result->p99_ms);
+		fprintf(file, "      \"max_ms\": %.6f,\n", result->max_ms);
+
+		fprintf(file, "      \"phases_ms_per_step\": {");
+		for (int zone = 0; zone < PROFILE_ZONE_COUNT; zone++) {
+			fprintf(file, "%s\"%s\": %.6f", zone ? ", " : "", profiler_zone_name((ProfileZone)zone), result->phase_ms[zone]);
+		}
+		fprintf(file, "},\n");
+
+		fprintf(file, "      \"initial_energy\": %.6f,\n", result->initial_energy);
+		fprintf(file, "      \"final_energy\": %.6f,\n", result->final_energy);
+		fprintf(file, "      \"contact_points\": %llu,\n", (unsigned long long)result->total_contact_points);
+		fprintf(file, "      \"bisection_iterations\": %llu,\n", (unsigned long long)result->total_bisection_iterations);
+		fprintf(file, "      \"overflows\": %llu\n", (unsigned long long)result->total_overflows);
+		fprintf(file, "    }%s\n", i + 1 < count ? "," : "");
+	}
+
+	fprintf(file, "  ]\n}\n");
+}
+
+void print_result(const SceneResult* const result) {
+	printf("%-8s size %-4d bodies %-4d mean %8.4f ms  p50 %8.4f ms  p99 %8.4f ms  energy %12.2f -> %12.2f\n",
+		SCENE_NAMES[result->type],
+		result->size,
+		result->num_bodies,
+		result->mean_ms,
+		result->p50_ms,
+		result->p99_ms,
+		result->initial_energy,
+		result->final_energy);
+
+	for (int zone = 0; zone < PROFILE_ZONE_COUNT; zone++) {
+		if (result->phase_ms[zone] > 0) {
+			printf("    %-24s %10.4f ms/step\n", profiler_zone_name((ProfileZone)zone), result->phase_ms[zone]);
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	int steps = 600;
+	int size = 0;
+	int rows = 0;
+	int scene = -1;
+	const char* out_path = "bench_results.json";
+	const char* label = "";
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+			steps = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+			size = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--rows") == 0 && i + 1 < argc) {
+			rows = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			out_path = argv[++i];
+		} else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+			label = argv[++i];
+		} else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+			const char* const name = argv[++i];
+			for (int type = 0; type < SCENE_COUNT; type++) {
+				if (strcmp(name, SCENE_NAMES[type]) == 0) {
+					scene = type;
+				}
+			}
+			if (scene < 0) {
+				printf("Unknown scene: %s\n", name);
+				return 1;
+			}
+		} else {
+			printf("Usage: %s [--steps N] [--scene ", argv[0]);
+			for (int type = 0; type < SCENE_COUNT; type++) {
+				printf("%s%s", type > 0 ? "|" : "", SCENE_NAMES[type]);
+			}
+			printf("] [--size N] [--rows M] [--out PATH] [--label TEXT]\n");
+			return 1;
+		}
+	}
+
+	if (steps <= 0) {
+		printf("--steps must be positive\n");
+		return 1;
+	}
+
+	profiler_set_summary_interval(0);
+
+	SceneResult results[SCENE_COUNT];
+	int num_results = 0;
+
+	for (int type = 0; type < SCENE_COUNT; type++) {
+		if (scene >= 0 && type != scene) {
+			continue;
+		}
+
+		const int scene_size = size > 0 ? size : SCENE_DEFAULT_SIZES[type];
+		const int scene_rows = type != SCENE_WALL ? 0 : rows > 0 ? rows : (scene_size * 2 + 2) / 3;
+		results[num_results] = run_scene((SceneType)type, scene_size, scene_rows, steps);
+		print_result(&results[num_results]);
+		num_results++;
+	}
+
+	FILE* const file = fopen(out_path, "wb");
+	if (!file) {
+		printf("Failed to open %s\n", out_path);
+		return 1;
+	}
+
+	write_results_json(file, label, results, num_results);
+	fclose(file);
+
+	printf("Wrote %s\n", out_path);
+
+	return 0;
+}
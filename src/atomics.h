@@ -0,0 +1,17 @@
+#pragma once
+
+// Atomics and thread local storage for MSVC and GCC/Clang. The values are longs, the adds
+// return the value before the add.
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define ATOMIC_ADD(value, amount) _InterlockedExchangeAdd((volatile long*)(value), (amount))
+#define ATOMIC_EXCHANGE(value, new_value) _InterlockedExchange((volatile long*)(value), (new_value))
+#define ATOMIC_LOAD(value) _InterlockedOr((volatile long*)(value), 0)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define ATOMIC_ADD(value, amount) __atomic_fetch_add((value), (amount), __ATOMIC_SEQ_CST)
+#define ATOMIC_EXCHANGE(value, new_value) __atomic_exchange_n((value), (new_value), __ATOMIC_SEQ_CST)
+#define ATOMIC_LOAD(value) __atomic_load_n((value), __ATOMIC_SEQ_CST)
+#define THREAD_LOCAL __thread
+#endif
@@ -0,0 +1,245 @@
+#include "body_state.h"
+#include "math_helper.h"
+#include "math_ops.h"
+#include "stats.h"
+#include <math.h>
+#include <string.h>
+
+uint32_t BODY_STATE_CLOCK = 0;
+
+// Orientations rotate column vectors, vec3_mul_mat3 computes orientation * v
+Vec4 orientation_to_quaternion(const Mat3* const orientation) {
+	const float (*const m)[3] = orientation->m;
+	const float trace = m[0][0] + m[1][1] + m[2][2];
+	Vec4 q;
+
+	// Take the root of the largest diagonal term, the others divide by it
+	if (trace > 0) {
+		const float s = sqrtf(trace + 1) * 2;
+		q = (Vec4){ (m[2][1] - m[1][2]) / s, (m[0][2] - m[2][0]) / s, (m[1][0] - m[0][1]) / s, s / 4 };
+	} else if (m[0][0] > m[1][1] && m[0][0] > m[2][2]) {
+		const float s = sqrtf(1 + m[0][0] - m[1][1] - m[2][2]) * 2;
+		q = (Vec4){ s / 4, (m[0][1] + m[1][0]) / s, (m[0][2] + m[2][0]) / s, (m[2][1] - m[1][2]) / s };
+	} else if (m[1][1] > m[2][2]) {
+		const float s = sqrtf(1 + m[1][1] - m[0][0] - m[2][2]) * 2;
+		q = (Vec4){ (m[0][1] + m[1][0]) / s, s / 4, (m[1][2] + m[2][1]) / s, (m[0][2] - m[2][0]) / s };
+	} else {
+		const float s = sqrtf(1 + m[2][2] - m[0][0] - m[1][1]) * 2;
+		q = (Vec4){ (m[0][2] + m[2][0]) / s, (m[1][2] + m[2][1]) / s, s / 4, (m[1][0] - m[0][1]) / s };
+	}
+
+	// Keep w positive so the sign does not flip between exports of a slowly turning body
+	if (q.w < 0) {
+		q = (Vec4){ -q.x, -q.y, -q.z, -q.w };
+	}
+	return q;
+}
+
+// Normalizes first, half precision quaternions are a little off unit length
+Mat3 quaternion_to_orientation(Vec4 q) {
+	const float length = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+	if (length == 0) {
+		return MAT3_IDENTITY;
+	}
+	q = (Vec4){ q.x / length, q.y / length, q.z / length, q.w / length };
+
+	const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+	return (Mat3){
+		{
+			{ 1 - 2 * (yy + zz),	2 * (xy - wz),			2 * (xz + wy)		},
+			{ 2 * (xy + wz),		1 - 2 * (xx + zz),		2 * (yz - wx)		},
+			{ 2 * (xz - wy),		2 * (yz + wx),			1 - 2 * (xx + yy)	},
+		}
+	};
+}
+
+void state_write(void* const* const arrays, const int num_components, const BodyStatePrecision precision, const int entry, const float* const values) {
+	if (!arrays[0]) {
+		return;
+	}
+	for (int i = 0; i < num_components; i++) {
+		if (precision == BODY_STATE_HALF) {
+			((uint16_t*)arrays[i])[entry] = float_to_half(values[i]);
+		} else {
+			((float*)arrays[i])[entry] = values[i];
+		}
+	}
+}
+
+// Returns false if the group is not in the arrays
+bool state_read(void* const* const arrays, const int num_components, const BodyStatePrecision precision, const int entry, float* const values) {
+	if (!arrays[0]) {
+		return false;
+	}
+	for (int i = 0; i < num_components; i++) {
+		values[i] = precision == BODY_STATE_HALF ? half_to_float(((const uint16_t*)arrays[i])[entry]) : ((const float*)arrays[i])[entry];
+	}
+	return true;
+}
+
+int body_state_export(const BodyStateArrays* const state, const uint32_t since, uint32_t* const next_since) {
+	// Changes after this export carry a later stamp than the one handed back
+	const uint32_t stamp = BODY_STATE_CLOCK++;
+	const bool angular = state->angular_velocity[0] != NULL;
+	int count = 0;
+
+	for (int i = 0; i < MAX_CUBES; i++) {
+		if (!ACTIVE_CUBES[i] || CUBES[i].state_stamp < since) {
+			continue;
+		}
+
+		const Cube* const cube = &CUBES[i];
+		const Vec4 q = orientation_to_quaternion(&cube->orientation);
+		const Vec3 angular_velocity = angular ? vec3_mul_mat3(cube->angular_velocity, &cube->orientation) : (Vec3){};
+
+		state->indices[count] = i;
+		state_write(state->position, 3, state->precision, count, (const float[]){ cube->position.x, cube->position.y, cube->position.z });
+		state_write(state->orientation, 4, state->precision, count, (const float[]){ q.x, q.y, q.z, q.w });
+		state_write(state->velocity, 3, state->precision, count, (const float[]){ cube->velocity.x, cube->velocity.y, cube->velocity.z });
+		state_write(state->angular_velocity, 3, state->precision, count, (const float[]){ angular_velocity.x, angular_velocity.y, angular_velocity.z });
+		count++;
+	}
+
+	if (next_since) {
+		*next_since = stamp + 1;
+	}
+	return count;
+}
+
+void body_state_import(const BodyStateArrays* const state, const int count) {
+	for (int entry = 0; entry < count; entry++) {
+		const int index = state->indices[entry];
+		if (index < 0 || index >= MAX_CUBES || !ACTIVE_CUBES[index]) {
+			continue;
+		}
+
+		Cube* const cube = &CUBES[index];
+		Vec3 position = cube->position;
+		Mat3 orientation = cube->orientation;
+		float values[4];
+
+		const bool has_position = state_read(state->position, 3, state->precision, entry, values);
+		if (has_position) {
+			position = (Vec3){ values[0], values[1], values[2] };
+		}
+		const bool has_orientation = state_read(state->orientation, 4, state->precision, entry, values);
+		if (has_orientation) {
+			orientation = quaternion_to_orientation((Vec4){ values[0], values[1], values[2], values[3] });
+		}
+
+		if (cube->type == BODY_STATIC) {
+			if (has_position || has_orientation) {
+				set_static_pose(cube, position, orientation);
+			}
+			continue;
+		}
+
+		if (has_position || has_orientation) {
+			cube->position = position;
+			cube->orientation = orientation;
+			invalidate_transform(cube);
+		}
+		if (state_read(state->velocity, 3, state->precision, entry, values)) {
+			cube->velocity = (Vec3){ values[0], values[1], values[2] };
+		}
+		// The new orientation is already set, so the body space velocity matches it
+		if (state_read(state->angular_velocity, 3, state->precision, entry, values)) {
+			cube->angular_velocity = rotate_to_local(&cube->orientation, (Vec3){ values[0], values[1], values[2] });
+		}
+		cube->state_stamp = BODY_STATE_CLOCK;
+		RESTING_CUBES[index] = false;
+	}
+}
+
+static const uint64_t XXH_PRIME_1 = 0x9e3779b185ebca87ull;
+static const uint64_t XXH_PRIME_2 = 0xc2b2ae3d27d4eb4full;
+static const uint64_t XXH_PRIME_3 = 0x165667b19e3779f9ull;
+static const uint64_t XXH_PRIME_4 = 0x85ebca77c2b2ae63ull;
+static const uint64_t XXH_PRIME_5 = 0x27d4eb2f165667c5ull;
+
+// One body as hashed, exactly three 32 byte stripes. Float bits are hashed, so -0 and 0 differ.
+typedef struct {
+	int32_t index;
+	int32_t type;
+	int32_t resting;
+	float position[3];
+	float orientation[9];
+	float velocity[3];
+	float angular_velocity[3];
+	uint32_t padding[3];
+} HashedBody;
+
+bool STEP_HASHING = false;
+
+uint64_t xxh_rotate(const uint64_t value, const int bits) {
+	return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t xxh_round(const uint64_t lane, const uint64_t input) {
+	return xxh_rotate(lane + input * XXH_PRIME_2, 31) * XXH_PRIME_1;
+}
+
+uint64_t xxh_merge(const uint64_t hash, const uint64_t lane) {
+	return (hash ^ xxh_round(0, lane)) * XXH_PRIME_1 + XXH_PRIME_4;
+}
+
+// XXH64 with seed 0 of the active bodies packed back to back. The four lanes are independent,
+// so the multiplies of a stripe overlap.
+uint64_t body_state_checksum() {
+	uint64_t lanes[4] = { XXH_PRIME_1 + XXH_PRIME_2, XXH_PRIME_2, 0, -XXH_PRIME_1 };
+	uint64_t length = 0;
+
+	for (int i = 0; i < MAX_CUBES; i++) {
+		if (!ACTIVE_CUBES[i]) {
+			continue;
+		}
+
+		const Cube* const cube = &CUBES[i];
+		HashedBody body = { .index = i, .type = cube->type, .resting = RESTING_CUBES[i] };
+		memcpy(body.position, &cube->position, sizeof(body.position));
+		memcpy(body.orientation, &cube->orientation, sizeof(body.orientation));
+		memcpy(body.velocity, &cube->velocity, sizeof(body.velocity));
+		memcpy(body.angular_velocity, &cube->angular_velocity, sizeof(body.angular_velocity));
+
+		uint64_t words[sizeof(HashedBody) / sizeof(uint64_t)];
+		memcpy(words, &body, sizeof(body));
+		for (int k = 0; k < (int)(sizeof(words) / sizeof(words[0])); k += 4) {
+			lanes[0] = xxh_round(lanes[0], words[k]);
+			lanes[1] = xxh_round(lanes[1], words[k + 1]);
+			lanes[2] = xxh_round(lanes[2], words[k + 2]);
+			lanes[3] = xxh_round(lanes[3], words[k + 3]);
+		}
+		length += sizeof(HashedBody);
+	}
+
+	uint64_t hash;
+	if (length > 0) {
+		hash = xxh_rotate(lanes[0], 1) + xxh_rotate(lanes[1], 7) + xxh_rotate(lanes[2], 12) + xxh_rotate(lanes[3], 18);
+		for (int k = 0; k < 4; k++) {
+			hash = xxh_merge(hash, lanes[k]);
+		}
+	} else {
+		hash = XXH_PRIME_5;
+	}
+	hash += length;
+
+	hash ^= hash >> 33;
+	hash *= XXH_PRIME_2;
+	hash ^= hash >> 29;
+	hash *= XXH_PRIME_3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+void body_state_hash_steps(const bool enabled) {
+	STEP_HASHING = enabled;
+}
+
+void body_state_end_step() {
+	if (STEP_HASHING) {
+		SIM_STATS.state_hash = body_state_checksum();
+	}
+}
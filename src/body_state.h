@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+#include "physics.h"
+
+// Bulk copies of the body state for renderers and the network, in one pass over the bodies.
+// The state goes to caller owned structure of arrays buffers, one array per component.
+
+typedef enum {
+	BODY_STATE_FLOAT, // The arrays hold floats
+	BODY_STATE_HALF // The arrays hold uint16_t half floats, see float_to_half
+} BodyStatePrecision;
+
+// Each array has room for MAX_CUBES entries. A NULL component group is skipped, the arrays of
+// a group are either all set or all NULL.
+typedef struct {
+	BodyStatePrecision precision;
+	int* indices; // Cube index of each entry, always set
+	void* position[3];
+	void* orientation[4]; // Unit quaternion x, y, z, w
+	void* velocity[3];
+	void* angular_velocity[3]; // World space, unlike Cube
+} BodyStateArrays;
+
+// Advanced by every export, bodies take its value when they move or are pushed
+extern uint32_t BODY_STATE_CLOCK;
+
+// Writes the active bodies that moved or were pushed since the stamp since, in cube order, and
+// returns how many. A since of 0 writes all of them. next_since receives the stamp to pass in
+// the next export of the same consumer and may be NULL. Removed bodies are not reported, a full
+// export lists the ones that are left.
+int body_state_export(const BodyStateArrays* const state, const uint32_t since, uint32_t* const next_since);
+
+// Sets the state of count entries back on their bodies and wakes them. Entries of inactive
+// bodies are skipped. Poses of static bodies move them like set_static_pose, their velocities
+// are left at 0.
+void body_state_import(const BodyStateArrays* const state, const int count);
+
+// 64-bit hash of the pose, velocities, type and resting flag of every active body, in cube
+// order. Builds with KINESIS_DETERMINISTIC give the same value for the same steps on any thread
+// count and on every peer running the same build.
+uint64_t body_state_checksum();
+
+// While enabled, physics_step hashes the bodies at its end into SIM_STATS.state_hash, next to
+// SIM_STATS.step_index. Off by default, the hash is 0 then.
+void body_state_hash_steps(const bool enabled);
+
+// Called by physics_step
+void body_state_end_step();
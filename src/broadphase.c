@@ -0,0 +1,255 @@
+#include "broadphase.h"
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+
+bool aabbs_intersect(const Vec3 a_min, const Vec3 a_max, const Vec3 b_min, const Vec3 b_max) {
+	return a_min.x <= b_max.x && b_min.x <= a_max.x &&
+		a_min.y <= b_max.y && b_min.y <= a_max.y &&
+		a_min.z <= b_max.z && b_min.z <= a_max.z;
+}
+
+bool ray_intersects_aabb(const Vec3 origin, const Vec3 inverse_direction, const float max_distance, const Vec3 min, const Vec3 max, float* const entry, float* const leave) {
+	float x0 = (min.x - origin.x) * inverse_direction.x;
+	float x1 = (max.x - origin.x) * inverse_direction.x;
+	float y0 = (min.y - origin.y) * inverse_direction.y;
+	float y1 = (max.y - origin.y) * inverse_direction.y;
+	float z0 = (min.z - origin.z) * inverse_direction.z;
+	float z1 = (max.z - origin.z) * inverse_direction.z;
+
+	// Plain comparisons rather than fminf and fmaxf, which are library calls on some targets. A
+	// ray running along a slab plane it starts on gives a NaN, which every comparison below skips,
+	// so that axis does not limit the ray and the box counts as hit. Grazing rays are kept rather
+	// than lost, the shape test decides.
+	if (x0 > x1) {
+		const float swap = x0;
+		x0 = x1;
+		x1 = swap;
+	}
+	if (y0 > y1) {
+		const float swap = y0;
+		y0 = y1;
+		y1 = swap;
+	}
+	if (z0 > z1) {
+		const float swap = z0;
+		z0 = z1;
+		z1 = swap;
+	}
+
+	float entry_distance = x0 > 0 ? x0 : 0;
+	entry_distance = y0 > entry_distance ? y0 : entry_distance;
+	entry_distance = z0 > entry_distance ? z0 : entry_distance;
+	float exit_distance = x1 < max_distance ? x1 : max_distance;
+	exit_distance = y1 < exit_distance ? y1 : exit_distance;
+	exit_distance = z1 < exit_distance ? z1 : exit_distance;
+
+	*entry = entry_distance;
+	*leave = exit_distance;
+	return entry_distance <= exit_distance;
+}
+
+float proxy_center(const AabbProxy* const proxy, const int axis) {
+	const float* const min = &proxy->min.x;
+	const float* const max = &proxy->max.x;
+	return (min[axis] + max[axis]) * 0.5f;
+}
+
+// Partially sorts proxies so that the one at index k has the median center along axis
+void select_median(AabbProxy* const proxies, int low, int high, const int k, const int axis) {
+	while (low < high) {
+		const float pivot = proxy_center(&proxies[(low + high) / 2], axis);
+		int i = low;
+		int j = high;
+
+		while (i <= j) {
+			while (proxy_center(&proxies[i], axis) < pivot) {
+				i++;
+			}
+			while (proxy_center(&proxies[j], axis) > pivot) {
+				j--;
+			}
+			if (i <= j) {
+				const AabbProxy temp = proxies[i];
+				proxies[i] = proxies[j];
+				proxies[j] = temp;
+				i++;
+				j--;
+			}
+		}
+
+		if (k <= j) {
+			high = j;
+		} else if (k >= i) {
+			low = i;
+		} else {
+			return;
+		}
+	}
+}
+
+int build_node(AabbTree* const tree, AabbProxy* const proxies, const int count) {
+	const int node_index = tree->num_nodes++;
+	AabbNode* const node = &tree->nodes[node_index];
+
+	Vec3 min = { FLT_MAX, FLT_MAX, FLT_MAX };
+	Vec3 max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (int i = 0; i < count; i++) {
+		min.x = fminf(min.x, proxies[i].min.x);
+		min.y = fminf(min.y, proxies[i].min.y);
+		min.z = fminf(min.z, proxies[i].min.z);
+		max.x = fmaxf(max.x, proxies[i].max.x);
+		max.y = fmaxf(max.y, proxies[i].max.y);
+		max.z = fmaxf(max.z, proxies[i].max.z);
+	}
+	node->min = min;
+	node->max = max;
+
+	if (count == 1) {
+		node->left = -1;
+		node->right = -1;
+		node->index = proxies[0].index;
+		return node_index;
+	}
+
+	// Split at the median along the longest axis
+	const Vec3 size = { max.x - min.x, max.y - min.y, max.z - min.z };
+	int axis = 0;
+	if (size.y > size.x && size.y >= size.z) {
+		axis = 1;
+	} else if (size.z > size.x && size.z > size.y) {
+		axis = 2;
+	}
+
+	const int half = count / 2;
+	select_median(proxies, 0, count - 1, half, axis);
+
+	node->index = -1;
+	const int left = build_node(tree, proxies, half);
+	const int right = build_node(tree, proxies + half, count - half);
+
+	tree->nodes[node_index].left = left;
+	tree->nodes[node_index].right = right;
+	return node_index;
+}
+
+void aabb_tree_build(AabbTree* const tree, AabbProxy* const proxies, int count) {
+	if (count > AABB_TREE_MAX_PROXIES) {
+		count = AABB_TREE_MAX_PROXIES;
+	}
+
+	tree->num_nodes = 0;
+	tree->root = count > 0 ? build_node(tree, proxies, count) : -1;
+}
+
+int aabb_tree_query(const AabbTree* const tree, const Vec3 min, const Vec3 max, int* const results, const int max_results) {
+	if (tree->root < 0) {
+		return 0;
+	}
+
+	// A balanced tree over AABB_TREE_MAX_PROXIES leaves is at most 9 levels deep
+	int stack[64];
+	int stack_size = 0;
+	int num_results = 0;
+	stack[stack_size++] = tree->root;
+
+	while (stack_size > 0) {
+		const AabbNode* const node = &tree->nodes[stack[--stack_size]];
+		if (!aabbs_intersect(min, max, node->min, node->max)) {
+			continue;
+		}
+
+		if (node->index >= 0) {
+			if (num_results >= max_results) {
+				break;
+			}
+			results[num_results++] = node->index;
+		} else {
+			stack[stack_size++] = node->left;
+			stack[stack_size++] = node->right;
+		}
+	}
+
+	return num_results;
+}
+
+// A box is fully outside a plane when its corner furthest along the plane normal is
+bool aabb_outside_plane(const Vec4 plane, const Vec3 min, const Vec3 max) {
+	const float x = plane.x < 0 ? min.x : max.x;
+	const float y = plane.y < 0 ? min.y : max.y;
+	const float z = plane.z < 0 ? min.z : max.z;
+	return plane.x * x + plane.y * y + plane.z * z + plane.w < 0;
+}
+
+int aabb_tree_query_planes(const AabbTree* const tree, const Vec4* const planes, const int num_planes, int* const results, const int max_results) {
+	if (tree->root < 0) {
+		return 0;
+	}
+
+	int stack[64];
+	int stack_size = 0;
+	int num_results = 0;
+	stack[stack_size++] = tree->root;
+
+	while (stack_size > 0) {
+		const AabbNode* const node = &tree->nodes[stack[--stack_size]];
+		bool outside = false;
+		for (int i = 0; i < num_planes && !outside; i++) {
+			outside = aabb_outside_plane(planes[i], node->min, node->max);
+		}
+		if (outside) {
+			continue;
+		}
+
+		if (node->index >= 0) {
+			if (num_results >= max_results) {
+				break;
+			}
+			results[num_results++] = node->index;
+		} else {
+			stack[stack_size++] = node->left;
+			stack[stack_size++] = node->right;
+		}
+	}
+
+	return num_results;
+}
+
+int aabb_tree_raycast(const AabbTree* const tree, const Vec3 origin, const Vec3 direction, const float max_distance, const Vec3 inflate, int* const results, float* const entries, const int max_results) {
+	if (tree->root < 0) {
+		return 0;
+	}
+
+	const Vec3 inverse_direction = { 1 / direction.x, 1 / direction.y, 1 / direction.z };
+
+	int stack[64];
+	int stack_size = 0;
+	int num_results = 0;
+	stack[stack_size++] = tree->root;
+
+	while (stack_size > 0) {
+		const AabbNode* const node = &tree->nodes[stack[--stack_size]];
+		const Vec3 min = { node->min.x - inflate.x, node->min.y - inflate.y, node->min.z - inflate.z };
+		const Vec3 max = { node->max.x + inflate.x, node->max.y + inflate.y, node->max.z + inflate.z };
+
+		float entry;
+		float leave;
+		if (!ray_intersects_aabb(origin, inverse_direction, max_distance, min, max, &entry, &leave)) {
+			continue;
+		}
+
+		if (node->index >= 0) {
+			if (num_results >= max_results) {
+				break;
+			}
+			results[num_results] = node->index;
+			entries[num_results] = entry;
+			num_results++;
+		} else {
+			stack[stack_size++] = node->left;
+			stack[stack_size++] = node->right;
+		}
+	}
+
+	return num_results;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "math_types.h"
+#include <stdbool.h>
+
+// Bounding volume hierarchy over axis aligned boxes, built top down by splitting
+// at the median of the longest axis. Rebuilding is cheap enough to do every step
+// for moving bodies, static bodies are kept in their own tree that is only rebuilt
+// when they change.
+
+typedef struct {
+	int index; // Caller defined, usually a body index
+	Vec3 min;
+	Vec3 max;
+} AabbProxy;
+
+typedef struct {
+	Vec3 min;
+	Vec3 max;
+	int left; // Child node indices, -1 for leaves
+	int right;
+	int index; // Proxy index of a leaf, -1 for internal nodes
+} AabbNode;
+
+enum { AABB_TREE_MAX_PROXIES = 256 };
+
+typedef struct {
+	AabbNode nodes[2 * AABB_TREE_MAX_PROXIES];
+	int num_nodes;
+	int root; // -1 when empty
+} AabbTree;
+
+bool aabbs_intersect(const Vec3 a_min, const Vec3 a_max, const Vec3 b_min, const Vec3 b_max);
+
+// Slab test of the ray origin + t * direction for t in [0, max_distance] against a box.
+// inverse_direction is 1 / direction per axis, infinite for zero components. Writes the
+// distances the ray enters the box at, 0 when it starts inside, and leaves it at.
+bool ray_intersects_aabb(const Vec3 origin, const Vec3 inverse_direction, const float max_distance, const Vec3 min, const Vec3 max, float* const entry, float* const leave);
+
+// Reorders proxies, count is clamped to AABB_TREE_MAX_PROXIES
+void aabb_tree_build(AabbTree* const tree, AabbProxy* const proxies, int count);
+
+// Writes the indices of all proxies overlapping the box, returns how many were found.
+// Stops after max_results.
+int aabb_tree_query(const AabbTree* const tree, const Vec3 min, const Vec3 max, int* const results, const int max_results);
+
+// Writes the indices of all proxies not fully outside any of the planes, returns how many were
+// found. A plane is x, y, z normal and w offset, with the inside where dot(normal, point) + w >= 0.
+// Stops after max_results.
+int aabb_tree_query_planes(const AabbTree* const tree, const Vec4* const planes, const int num_planes, int* const results, const int max_results);
+
+// Writes the indices of all proxies the ray enters before max_distance, with boxes grown by
+// inflate on each side for swept shapes, and the distance the ray enters each of them at.
+// Returns how many were found, in no particular order. Stops after max_results.
+int aabb_tree_raycast(const AabbTree* const tree, const Vec3 origin, const Vec3 direction, const float max_distance, const Vec3 inflate, int* const results, float* const entries, const int max_results);
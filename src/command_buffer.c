@@ -0,0 +1,206 @@
+#include "command_buffer.h"
+#include "atomics.h"
+#include "body_state.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+	COMMAND_CREATE,
+	COMMAND_DESTROY,
+	COMMAND_SET_VELOCITY,
+	COMMAND_APPLY_IMPULSE
+} CommandType;
+
+typedef struct {
+	CommandType type;
+	Cube* cube;
+	Cube** created;
+	BodyDesc body;
+	Vec3 linear; // Velocity or impulse
+	Vec3 angular; // Angular velocity or the point of the impulse
+} Command;
+
+// Threads record into one buffer while the step applies the other one
+typedef struct {
+	Command commands[MAX_COMMANDS];
+	volatile long count; // Slots handed out, passes MAX_COMMANDS once full
+	volatile long writers; // Threads still writing their command
+} CommandBuffer;
+
+CommandBuffer COMMAND_BUFFERS[2] = {};
+volatile long RECORDING_BUFFER = 0;
+
+bool command_record(const Command* const command) {
+	while (true) {
+		const long buffer_index = ATOMIC_LOAD(&RECORDING_BUFFER);
+		CommandBuffer* const buffer = &COMMAND_BUFFERS[buffer_index];
+		ATOMIC_ADD(&buffer->writers, 1);
+
+		// A flush that switched buffers before this writer registered does not wait for it
+		if (ATOMIC_LOAD(&RECORDING_BUFFER) != buffer_index) {
+			ATOMIC_ADD(&buffer->writers, -1);
+			continue;
+		}
+
+		const long index = ATOMIC_ADD(&buffer->count, 1);
+		if (index < MAX_COMMANDS) {
+			buffer->commands[index] = *command;
+		}
+		ATOMIC_ADD(&buffer->writers, -1);
+		return index < MAX_COMMANDS;
+	}
+}
+
+bool command_create(const BodyDesc* const body, Cube** const created) {
+	const Command command = { .type = COMMAND_CREATE, .created = created, .body = *body };
+	return command_record(&command);
+}
+
+bool command_destroy(Cube* const cube) {
+	const Command command = { .type = COMMAND_DESTROY, .cube = cube };
+	return command_record(&command);
+}
+
+bool command_set_velocity(Cube* const cube, const Vec3 velocity, const Vec3 angular_velocity) {
+	const Command command = { .type = COMMAND_SET_VELOCITY, .cube = cube, .linear = velocity, .angular = angular_velocity };
+	return command_record(&command);
+}
+
+bool command_apply_impulse(Cube* const cube, const Vec3 impulse, const Vec3 point) {
+	const Command command = { .type = COMMAND_APPLY_IMPULSE, .cube = cube, .linear = impulse, .angular = point };
+	return command_record(&command);
+}
+
+Cube* body_create(const BodyDesc* const body) {
+	const float mass = body->type == BODY_DYNAMIC ? body->mass : 0;
+	Cube* cube = NULL;
+
+	switch (body->shape) {
+		case SHAPE_BOX: cube = add_box(body->position, body->orientation, body->half_extents, mass); break;
+		case SHAPE_SPHERE: cube = add_sphere(body->position, body->radius, mass); break;
+		case SHAPE_CAPSULE: cube = add_capsule(body->position, body->orientation, body->radius, body->half_height, mass); break;
+		case SHAPE_HULL: cube = add_hull(body->position, body->orientation, body->hull, mass); break;
+		case SHAPE_MESH: cube = add_mesh(body->position, body->orientation, body->mesh); break;
+		case SHAPE_HEIGHTFIELD: cube = add_heightfield(body->position, body->orientation, body->heightfield); break;
+		case SHAPE_COMPOUND: cube = add_compound(body->position, body->orientation, body->compound); break;
+		default: break;
+	}
+
+	// Kinematic bodies start out static, like add_kinematic_box
+	if (cube && body->type == BODY_KINEMATIC && cube->type == BODY_STATIC) {
+		cube->type = BODY_KINEMATIC;
+	}
+	return cube;
+}
+
+#ifdef KINESIS_DETERMINISTIC
+// Everything a command does except the pointers, zeroed first so memcmp sees no padding
+typedef struct {
+	int type;
+	int index;
+	int shape;
+	int body_type;
+	float values[24];
+	uint32_t order_key;
+} CommandKey;
+
+CommandKey command_key(const Command* const command) {
+	CommandKey key;
+	memset(&key, 0, sizeof(key));
+	key.type = command->type;
+	key.index = command->cube ? command->cube->index : -1;
+	key.shape = command->body.shape;
+	key.body_type = command->body.type;
+
+	const BodyDesc* const body = &command->body;
+	const float values[] = {
+		command->linear.x, command->linear.y, command->linear.z,
+		command->angular.x, command->angular.y, command->angular.z,
+		body->position.x, body->position.y, body->position.z,
+		body->orientation.m[0][0], body->orientation.m[0][1], body->orientation.m[0][2],
+		body->orientation.m[1][0], body->orientation.m[1][1], body->orientation.m[1][2],
+		body->orientation.m[2][0], body->orientation.m[2][1], body->orientation.m[2][2],
+		body->half_extents.x, body->half_extents.y, body->half_extents.z,
+		body->radius, body->half_height, body->mass
+	};
+	memcpy(key.values, values, sizeof(values));
+	key.order_key = body->order_key;
+	return key;
+}
+
+// Any fixed order will do, so keys are compared as bytes. Commands with equal keys do the same
+// thing, except creates told apart only by their shapes or created, see BodyDesc::order_key.
+int command_compare(const void* const a, const void* const b) {
+	const CommandKey key_a = command_key(*(const Command* const*)a);
+	const CommandKey key_b = command_key(*(const Command* const*)b);
+	return memcmp(&key_a, &key_b, sizeof(CommandKey));
+}
+#endif
+
+void commands_flush() {
+	const long buffer_index = ATOMIC_EXCHANGE(&RECORDING_BUFFER, 1 - RECORDING_BUFFER);
+	CommandBuffer* const buffer = &COMMAND_BUFFERS[buffer_index];
+
+	// Writers only copy one command, so waiting for them is short
+	while (ATOMIC_LOAD(&buffer->writers) != 0) {
+	}
+
+	const long count = ATOMIC_LOAD(&buffer->count);
+	const int num_commands = count < MAX_COMMANDS ? (int)count : MAX_COMMANDS;
+
+	// A removed slot may be reused by a create in the same batch, later commands on the old
+	// body must not reach the new one
+	bool removed[MAX_CUBES] = {};
+
+	const Command* order[MAX_COMMANDS];
+	for (int i = 0; i < num_commands; i++) {
+		order[i] = &buffer->commands[i];
+	}
+
+#ifdef KINESIS_DETERMINISTIC
+	// The order threads record in changes from run to run, and with it the slots new bodies
+	// land in. Sorting by content gives the same world whatever the order was.
+	qsort(order, num_commands, sizeof(order[0]), command_compare);
+#endif
+
+	for (int i = 0; i < num_commands; i++) {
+		const Command* const command = order[i];
+
+		if (command->type == COMMAND_CREATE) {
+			Cube* const cube = body_create(&command->body);
+			if (command->created) {
+				*command->created = cube;
+			}
+			continue;
+		}
+
+		Cube* const cube = command->cube;
+		if (cube->index < 0 || !ACTIVE_CUBES[cube->index] || removed[cube->index]) {
+			continue;
+		}
+
+		switch (command->type) {
+			case COMMAND_DESTROY: {
+				remove_body(cube);
+				removed[cube->index] = true;
+				break;
+			}
+			case COMMAND_SET_VELOCITY: {
+				cube->velocity = command->linear;
+				cube->angular_velocity = command->angular;
+				cube->state_stamp = BODY_STATE_CLOCK;
+				RESTING_CUBES[cube->index] = false;
+				break;
+			}
+			case COMMAND_APPLY_IMPULSE: {
+				apply_impulse(cube, command->linear, command->angular);
+				break;
+			}
+			default: {
+				break;
+			}
+		}
+	}
+
+	buffer->count = 0;
+}
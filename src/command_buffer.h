@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdbool.h>
+#include "physics.h"
+
+// Body changes recorded from any thread while the world runs and applied together, in the
+// order they were recorded, at the start of the next physics_step. Adding and removing bodies
+// only marks the broadphase trees, which the step then rebuilds once for the whole batch. The
+// record functions return false when the buffer for the next step is full.
+
+enum { MAX_COMMANDS = 1024 };
+
+// What the add functions take, for bodies created through the command buffer
+typedef struct {
+	ShapeType shape;
+	BodyType type; // Dynamic bodies need a mass, compounds bring their own
+	Vec3 position;
+	Mat3 orientation;
+	Vec3 half_extents; // Boxes
+	float radius; // Spheres and capsules
+	float half_height; // Capsules
+	float mass;
+	// Owned by the caller, must outlive the body
+	const ConvexHull* hull;
+	const TriangleMesh* mesh;
+	const Heightfield* heightfield;
+	const CompoundShape* compound;
+	// Orders creates in deterministic builds that are otherwise equal apart from their shape or
+	// created pointers, ignored in other builds
+	uint32_t order_key;
+} BodyDesc;
+
+// created receives the new body when the command is applied, NULL when no slot was free. It
+// may be NULL, and must stay valid until the next step.
+bool command_create(const BodyDesc* const body, Cube** const created);
+bool command_destroy(Cube* const cube);
+
+// angular_velocity is in body space, as stored in Cube
+bool command_set_velocity(Cube* const cube, const Vec3 velocity, const Vec3 angular_velocity);
+
+// Impulse at a world space point, as apply_impulse
+bool command_apply_impulse(Cube* const cube, const Vec3 impulse, const Vec3 point);
+
+// Applies the recorded commands, called by physics_step. Commands on a body that was removed
+// in the meantime are skipped. Deterministic builds apply them sorted by type, body and
+// values instead of in recording order. Pointers never take part, which keeps the order the
+// same across runs and peers, so creates that only differ in them need distinct order_keys.
+// Several commands on one body that depend on their order should be recorded in separate steps.
+void commands_flush();
+
+// Adds a body right away
+Cube* body_create(const BodyDesc* const body);
@@ -0,0 +1,164 @@
+#include "contact_events.h"
+#include "math_ops.h"
+#include "snapshot.h"
+#include "stats.h"
+#include <string.h>
+
+// Touching pair of bodies, keyed by the lower body index first, -1 for the floor
+typedef struct {
+	int low;
+	int high;
+	Cube* cube_a;
+	Cube* cube_b;
+	Vec3 point;
+	Vec3 normal;
+	float impulse;
+	bool removed; // A body of the pair was removed, the pair ends even if its slot is reused
+} TouchingPair;
+
+enum { MAX_TOUCHING_PAIRS = 512 };
+
+// Pairs touching after the last step, sorted by key
+TouchingPair TOUCHING_PAIRS[MAX_TOUCHING_PAIRS] = {};
+int NUM_TOUCHING_PAIRS = 0;
+
+// Pairs found by the current step, in manifold order until the end of the step
+TouchingPair STEP_PAIRS[MAX_TOUCHING_PAIRS] = {};
+int NUM_STEP_PAIRS = 0;
+
+ContactEvent CONTACT_EVENTS[MAX_CONTACT_EVENTS] = {};
+int NUM_CONTACT_EVENTS = 0;
+
+const ContactEvent* contact_events_get(int* const count) {
+	*count = NUM_CONTACT_EVENTS;
+	return CONTACT_EVENTS;
+}
+
+void contact_events_reset() {
+	NUM_TOUCHING_PAIRS = 0;
+	NUM_STEP_PAIRS = 0;
+	NUM_CONTACT_EVENTS = 0;
+}
+
+// Pairs and events between steps, the step pairs are empty then
+int contact_events_state_sections(StateSection* const sections) {
+	sections[0] = (StateSection){ TOUCHING_PAIRS, sizeof(TOUCHING_PAIRS) };
+	sections[1] = (StateSection){ &NUM_TOUCHING_PAIRS, sizeof(NUM_TOUCHING_PAIRS) };
+	sections[2] = (StateSection){ CONTACT_EVENTS, sizeof(CONTACT_EVENTS) };
+	sections[3] = (StateSection){ &NUM_CONTACT_EVENTS, sizeof(NUM_CONTACT_EVENTS) };
+	return 4;
+}
+
+void contact_events_add(const ContactManifold* const contact_manifold, const float impulse) {
+	if (NUM_STEP_PAIRS >= MAX_TOUCHING_PAIRS || contact_manifold->num_points == 0) {
+		return;
+	}
+
+	const Pose pose_a = cube_pose(contact_manifold->cube_a);
+	Vec3 point = {};
+	for (int i = 0; i < contact_manifold->num_points; i++) {
+		point = vec3_add(point, pose_to_world(&pose_a, contact_manifold->local_points_a[i]));
+	}
+
+	const int index_a = contact_manifold->cube_a->index;
+	const int index_b = contact_manifold->cube_b->index;
+	TouchingPair* const pair = &STEP_PAIRS[NUM_STEP_PAIRS++];
+	pair->low = index_a < index_b ? index_a : index_b;
+	pair->high = index_a < index_b ? index_b : index_a;
+	pair->cube_a = contact_manifold->cube_a;
+	pair->cube_b = contact_manifold->cube_b;
+	pair->point = vec3_scale(point, 1.0f / contact_manifold->num_points);
+	pair->normal = contact_manifold->normal;
+	pair->impulse = impulse;
+	pair->removed = false;
+}
+
+void contact_events_forget(const int index) {
+	for (int i = 0; i < NUM_TOUCHING_PAIRS; i++) {
+		if (TOUCHING_PAIRS[i].low == index || TOUCHING_PAIRS[i].high == index) {
+			TOUCHING_PAIRS[i].removed = true;
+		}
+	}
+}
+
+bool pair_less(const TouchingPair* const a, const TouchingPair* const b) {
+	return a->low < b->low || (a->low == b->low && a->high < b->high);
+}
+
+bool pair_resting(const TouchingPair* const pair) {
+	return (pair->low >= 0 && RESTING_CUBES[pair->low]) || RESTING_CUBES[pair->high];
+}
+
+void contact_events_emit(const ContactEventType type, const TouchingPair* const pair) {
+	if (NUM_CONTACT_EVENTS >= MAX_CONTACT_EVENTS) {
+		SIM_STATS.contact_event_overflows++;
+		return;
+	}
+
+	CONTACT_EVENTS[NUM_CONTACT_EVENTS++] = (ContactEvent){
+		.type = type,
+		.cube_a = pair->cube_a,
+		.cube_b = pair->cube_b,
+		.point = pair->point,
+		.normal = pair->normal,
+		.impulse = type == CONTACT_END ? 0 : pair->impulse
+	};
+}
+
+// Compares the pairs of this step with those of the last one, both sorted by key
+void contact_events_end_step() {
+	// Manifolds come out of the step almost in key order already. A pair found twice keeps the
+	// first manifold with the impulses of both.
+	int num_step_pairs = 0;
+	for (int k = 0; k < NUM_STEP_PAIRS; k++) {
+		const TouchingPair pair = STEP_PAIRS[k];
+		int m = num_step_pairs - 1;
+		while (m >= 0 && pair_less(&pair, &STEP_PAIRS[m])) {
+			m--;
+		}
+		if (m >= 0 && !pair_less(&STEP_PAIRS[m], &pair)) {
+			STEP_PAIRS[m].impulse += pair.impulse;
+			continue;
+		}
+
+		memmove(&STEP_PAIRS[m + 2], &STEP_PAIRS[m + 1], (num_step_pairs - m - 1) * sizeof(TouchingPair));
+		STEP_PAIRS[m + 1] = pair;
+		num_step_pairs++;
+	}
+
+	NUM_CONTACT_EVENTS = 0;
+	TouchingPair touching[MAX_TOUCHING_PAIRS];
+	int num_touching = 0;
+	int previous = 0;
+	int current = 0;
+
+	while (previous < NUM_TOUCHING_PAIRS || current < num_step_pairs) {
+		const TouchingPair* const last = previous < NUM_TOUCHING_PAIRS ? &TOUCHING_PAIRS[previous] : NULL;
+		const TouchingPair* const found = current < num_step_pairs ? &STEP_PAIRS[current] : NULL;
+		const TouchingPair* kept = found;
+
+		if (found && (!last || pair_less(found, last))) {
+			contact_events_emit(CONTACT_BEGIN, found);
+			current++;
+		} else if (!found || pair_less(last, found) || last->removed) {
+			// Resting bodies skip the narrowphase, so their pairs are kept as they were
+			kept = !last->removed && pair_resting(last) ? last : NULL;
+			if (!kept) {
+				contact_events_emit(CONTACT_END, last);
+			}
+			previous++;
+		} else {
+			contact_events_emit(CONTACT_PERSIST, found);
+			previous++;
+			current++;
+		}
+
+		if (kept && num_touching < MAX_TOUCHING_PAIRS) {
+			touching[num_touching++] = *kept;
+		}
+	}
+
+	memcpy(TOUCHING_PAIRS, touching, num_touching * sizeof(TouchingPair));
+	NUM_TOUCHING_PAIRS = num_touching;
+	NUM_STEP_PAIRS = 0;
+}
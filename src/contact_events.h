@@ -0,0 +1,37 @@
+#pragma once
+
+#include "physics.h"
+
+// Begin, persist and end events for touching pairs of bodies. physics_step writes them into a
+// flat array after its solver, and the caller reads them once the step returns. Nothing is
+// called back from inside the step. The floor is the body GROUND. A pair whose dynamic body
+// rests keeps touching without events until it wakes up.
+
+typedef enum {
+	CONTACT_BEGIN,
+	CONTACT_PERSIST,
+	CONTACT_END
+} ContactEventType;
+
+typedef struct {
+	ContactEventType type;
+	Cube* cube_a;
+	Cube* cube_b;
+	Vec3 point; // World space mean of the contact points, where the pair last touched for end events
+	Vec3 normal; // World space, from cube_b towards cube_a
+	float impulse; // Normal impulse the solver applied over the step, 0 for end events
+} ContactEvent;
+
+enum { MAX_CONTACT_EVENTS = 512 };
+
+// Events of the last step, sorted by pair. They stay valid until the next step, a step with
+// more than MAX_CONTACT_EVENTS counts the dropped ones in SIM_STATS.contact_event_overflows.
+const ContactEvent* contact_events_get(int* const count);
+
+// Called by physics_step and physics_reset
+void contact_events_reset();
+void contact_events_add(const ContactManifold* const contact_manifold, const float impulse);
+void contact_events_end_step();
+
+// Called by remove_body, the body's pairs end in the next step
+void contact_events_forget(const int index);
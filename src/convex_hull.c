@@ -0,0 +1,332 @@
+#include "convex_hull.h"
+#include "math_ops.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Distance within which a point counts as on a face plane, relative to the size of the hull
+static const float CONVEX_HULL_PLANE_TOLERANCE = 1e-4f;
+
+// Faces of the hull under construction, at most 2V - 4 plus the ones a new point adds
+enum { CONVEX_HULL_MAX_FACES = 4 * CONVEX_HULL_MAX_VERTICES };
+
+typedef struct {
+	int vertices[3]; // Input point indices
+	Vec3 normal; // Unit length, pointing out of the hull
+	float offset; // Plane distance from the origin along normal
+	int furthest; // Input point furthest above the face, -1 if none is above it
+	float furthest_distance;
+	bool visible; // Seen from the point being added
+} HullFace;
+
+float hull_face_distance(const HullFace* const face, const Vec3 point) {
+	return vec3_dot(face->normal, point) - face->offset;
+}
+
+// Orients the face so interior, a point inside the hull, lies below it
+HullFace hull_face_make(const Vec3* const points, const int a, int b, int c, const Vec3 interior) {
+	Vec3 normal = vec3_cross(vec3_sub(points[b], points[a]), vec3_sub(points[c], points[a]));
+	const float length = vec3_length(normal);
+	normal = length > 0 ? vec3_scale(normal, 1 / length) : normal;
+	if (vec3_dot(normal, vec3_sub(interior, points[a])) > 0) {
+		const int swap = b;
+		b = c;
+		c = swap;
+		normal = vec3_scale(normal, -1);
+	}
+
+	return (HullFace){
+		.vertices = { a, b, c },
+		.normal = normal,
+		.offset = vec3_dot(normal, points[a]),
+		.furthest = -1,
+		.furthest_distance = 0
+	};
+}
+
+// Files a point under the first face it lies above, so it is only tested again once that face
+// is replaced. Returns the face index or -1 when the point is inside.
+int hull_assign_point(HullFace* const faces, const int first_face, const int num_faces, const Vec3* const points, const int point, const float tolerance) {
+	for (int f = first_face; f < num_faces; f++) {
+		const float distance = hull_face_distance(&faces[f], points[point]);
+		if (distance > tolerance) {
+			if (distance > faces[f].furthest_distance) {
+				faces[f].furthest_distance = distance;
+				faces[f].furthest = point;
+			}
+			return f;
+		}
+	}
+	return -1;
+}
+
+// Input points on the faces, in input order
+int hull_face_points(const HullFace* const faces, const int num_faces, int* const hull_points) {
+	int count = 0;
+	for (int f = 0; f < num_faces; f++) {
+		for (int v = 0; v < 3; v++) {
+			const int point = faces[f].vertices[v];
+			int k = count;
+			while (k > 0 && hull_points[k - 1] > point) {
+				k--;
+			}
+			if (k > 0 && hull_points[k - 1] == point) {
+				continue;
+			}
+			for (int m = count; m > k; m--) {
+				hull_points[m] = hull_points[m - 1];
+			}
+			hull_points[k] = point;
+			count++;
+		}
+	}
+	return count;
+}
+
+// Tetrahedron of the widest pair of axis extremes, the point furthest from their line and the
+// point furthest from their plane. Returns false if the points are all on a plane.
+bool hull_initial_simplex(const Vec3* const points, const int count, const float tolerance, int* const simplex) {
+	int extremes[3][2] = {};
+	for (int i = 0; i < count; i++) {
+		const float values[3] = { points[i].x, points[i].y, points[i].z };
+		for (int axis = 0; axis < 3; axis++) {
+			const Vec3 low = points[extremes[axis][0]];
+			const Vec3 high = points[extremes[axis][1]];
+			if (values[axis] < (axis == 0 ? low.x : axis == 1 ? low.y : low.z)) {
+				extremes[axis][0] = i;
+			}
+			if (values[axis] > (axis == 0 ? high.x : axis == 1 ? high.y : high.z)) {
+				extremes[axis][1] = i;
+			}
+		}
+	}
+
+	float widest = 0;
+	for (int axis = 0; axis < 3; axis++) {
+		const float width = vec3_length(vec3_sub(points[extremes[axis][1]], points[extremes[axis][0]]));
+		if (width > widest) {
+			widest = width;
+			simplex[0] = extremes[axis][0];
+			simplex[1] = extremes[axis][1];
+		}
+	}
+	if (widest <= tolerance) {
+		return false;
+	}
+
+	const Vec3 line = vec3_scale(vec3_sub(points[simplex[1]], points[simplex[0]]), 1 / widest);
+	float furthest = 0;
+	for (int i = 0; i < count; i++) {
+		const float distance = vec3_length(vec3_cross(line, vec3_sub(points[i], points[simplex[0]])));
+		if (distance > furthest) {
+			furthest = distance;
+			simplex[2] = i;
+		}
+	}
+	if (furthest <= tolerance) {
+		return false;
+	}
+
+	const Vec3 normal = vec3_normalize(vec3_cross(line, vec3_sub(points[simplex[2]], points[simplex[0]])));
+	furthest = 0;
+	for (int i = 0; i < count; i++) {
+		const float distance = fabsf(vec3_dot(normal, vec3_sub(points[i], points[simplex[0]])));
+		if (distance > furthest) {
+			furthest = distance;
+			simplex[3] = i;
+		}
+	}
+	return furthest > tolerance;
+}
+
+// Quickhull: starts from a tetrahedron and keeps adding the point furthest outside the hull.
+// Hulls that need more than CONVEX_HULL_MAX_VERTICES vertices stop there, which keeps the most
+// outlying points and leaves the hull slightly inside the input.
+bool convex_hull_build(ConvexHull* const hull, const Vec3* const points, const int count) {
+	hull->num_vertices = 0;
+	if (count < 4) {
+		return false;
+	}
+
+	float size = 0;
+	for (int i = 0; i < count; i++) {
+		size = fmaxf(size, fmaxf(fabsf(points[i].x), fmaxf(fabsf(points[i].y), fabsf(points[i].z))));
+	}
+	const float tolerance = CONVEX_HULL_PLANE_TOLERANCE * size;
+
+	int simplex[4] = {};
+	if (!hull_initial_simplex(points, count, tolerance, simplex)) {
+		return false;
+	}
+
+	// Face each point lies above, -1 once it is inside or on the hull
+	int* const point_faces = malloc(count * sizeof(int));
+	if (!point_faces) {
+		return false;
+	}
+
+	Vec3 interior = {};
+	for (int i = 0; i < 4; i++) {
+		interior = vec3_add(interior, vec3_scale(points[simplex[i]], 0.25f));
+	}
+
+	HullFace faces[CONVEX_HULL_MAX_FACES];
+	int num_faces = 0;
+	for (int i = 0; i < 4; i++) {
+		faces[num_faces++] = hull_face_make(points, simplex[i], simplex[(i + 1) % 4], simplex[(i + 2) % 4], interior);
+	}
+	for (int i = 0; i < count; i++) {
+		point_faces[i] = hull_assign_point(faces, 0, num_faces, points, i, tolerance);
+	}
+
+	int hull_points[CONVEX_HULL_MAX_FACES];
+	int num_vertices = 4;
+
+	while (num_vertices < CONVEX_HULL_MAX_VERTICES) {
+		int face_index = -1;
+		for (int f = 0; f < num_faces; f++) {
+			if (faces[f].furthest >= 0 && (face_index < 0 || faces[f].furthest_distance > faces[face_index].furthest_distance)) {
+				face_index = f;
+			}
+		}
+		if (face_index < 0) {
+			break;
+		}
+
+		const int apex = faces[face_index].furthest;
+
+		// The faces the new point sees are replaced by a fan from it to their boundary, which is
+		// made of the edges only one of them has
+		int horizon[CONVEX_HULL_MAX_FACES * 3][2];
+		int num_horizon = 0;
+		int num_kept = 0;
+		for (int f = 0; f < num_faces; f++) {
+			faces[f].visible = f == face_index || hull_face_distance(&faces[f], points[apex]) > tolerance;
+			if (!faces[f].visible) {
+				num_kept++;
+				continue;
+			}
+
+			for (int e = 0; e < 3; e++) {
+				const int a = faces[f].vertices[e];
+				const int b = faces[f].vertices[(e + 1) % 3];
+				int shared = 0;
+				while (shared < num_horizon && !((horizon[shared][0] == b && horizon[shared][1] == a) || (horizon[shared][0] == a && horizon[shared][1] == b))) {
+					shared++;
+				}
+				if (shared < num_horizon) {
+					num_horizon--;
+					horizon[shared][0] = horizon[num_horizon][0];
+					horizon[shared][1] = horizon[num_horizon][1];
+				} else {
+					horizon[num_horizon][0] = a;
+					horizon[num_horizon][1] = b;
+					num_horizon++;
+				}
+			}
+		}
+		if (num_kept + num_horizon > CONVEX_HULL_MAX_FACES) {
+			break;
+		}
+
+		int face_remap[CONVEX_HULL_MAX_FACES];
+		num_kept = 0;
+		for (int f = 0; f < num_faces; f++) {
+			face_remap[f] = faces[f].visible ? -1 : num_kept;
+			if (!faces[f].visible) {
+				faces[num_kept++] = faces[f];
+			}
+		}
+		for (int h = 0; h < num_horizon; h++) {
+			faces[num_kept + h] = hull_face_make(points, horizon[h][0], horizon[h][1], apex, interior);
+		}
+		num_faces = num_kept + num_horizon;
+
+		// Points of the replaced faces move to a new face or are inside now
+		point_faces[apex] = -1;
+		for (int i = 0; i < count; i++) {
+			if (point_faces[i] >= 0) {
+				const int kept = face_remap[point_faces[i]];
+				point_faces[i] = kept >= 0 ? kept : hull_assign_point(faces, num_kept, num_faces, points, i, tolerance);
+			}
+		}
+
+		// The new point can bury earlier vertices
+		num_vertices = hull_face_points(faces, num_faces, hull_points);
+	}
+	free(point_faces);
+
+	// Neighbours are the edges of the faces, coplanar faces only add shortcuts
+	num_vertices = hull_face_points(faces, num_faces, hull_points);
+	uint64_t adjacency[CONVEX_HULL_MAX_VERTICES] = {};
+	for (int f = 0; f < num_faces; f++) {
+		int corners[3];
+		for (int v = 0; v < 3; v++) {
+			int k = 0;
+			while (hull_points[k] != faces[f].vertices[v]) {
+				k++;
+			}
+			corners[v] = k;
+		}
+		for (int v = 0; v < 3; v++) {
+			adjacency[corners[v]] |= (1ull << corners[(v + 1) % 3]) | (1ull << corners[(v + 2) % 3]);
+		}
+	}
+
+	hull->half_extents = (Vec3){};
+	int num_neighbours = 0;
+	for (int i = 0; i < num_vertices; i++) {
+		const Vec3 vertex = points[hull_points[i]];
+		hull->vertices[i] = vertex;
+		hull->neighbour_offsets[i] = num_neighbours;
+
+		hull->half_extents.x = fmaxf(hull->half_extents.x, fabsf(vertex.x));
+		hull->half_extents.y = fmaxf(hull->half_extents.y, fabsf(vertex.y));
+		hull->half_extents.z = fmaxf(hull->half_extents.z, fabsf(vertex.z));
+
+		for (int j = 0; j < num_vertices; j++) {
+			if (adjacency[i] & (1ull << j)) {
+				hull->neighbours[num_neighbours++] = (unsigned char)j;
+			}
+		}
+	}
+	hull->num_vertices = num_vertices;
+	hull->neighbour_offsets[num_vertices] = num_neighbours;
+
+	return true;
+}
+
+int convex_hull_support(const ConvexHull* const hull, const Vec3 direction, int* const hint) {
+	int best = *hint >= 0 && *hint < hull->num_vertices ? *hint : 0;
+	float best_projection = vec3_dot(hull->vertices[best], direction);
+
+	if (hull->num_vertices < CONVEX_HULL_HILL_CLIMB_MIN_VERTICES) {
+		for (int i = 0; i < hull->num_vertices; i++) {
+			const float projection = vec3_dot(hull->vertices[i], direction);
+			if (projection > best_projection) {
+				best_projection = projection;
+				best = i;
+			}
+		}
+	} else {
+		// A linear function over a convex polytope has no local maxima other than the global
+		// one, so walking to any better neighbour until there is none finds the support vertex
+		bool improved = true;
+		while (improved) {
+			improved = false;
+			const int current = best;
+			for (int n = hull->neighbour_offsets[current]; n < hull->neighbour_offsets[current + 1]; n++) {
+				const int neighbour = hull->neighbours[n];
+				const float projection = vec3_dot(hull->vertices[neighbour], direction);
+				if (projection > best_projection) {
+					best_projection = projection;
+					best = neighbour;
+					improved = true;
+				}
+			}
+		}
+	}
+
+	*hint = best;
+	return best;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "math_types.h"
+#include <stdbool.h>
+
+// Convex hull collider built from a vertex list. Only the points on the hull are kept,
+// together with the edges between them so the support mapping can hill climb instead of
+// scanning every vertex.
+
+enum {
+	CONVEX_HULL_MAX_VERTICES = 64,
+	// Below this many vertices a linear scan beats walking the adjacency
+	CONVEX_HULL_HILL_CLIMB_MIN_VERTICES = 16
+};
+
+typedef struct {
+	Vec3 vertices[CONVEX_HULL_MAX_VERTICES]; // Body space
+	int num_vertices;
+
+	// Neighbours of vertex i are neighbours[neighbour_offsets[i]] up to neighbours[neighbour_offsets[i + 1]]
+	int neighbour_offsets[CONVEX_HULL_MAX_VERTICES + 1];
+	unsigned char neighbours[CONVEX_HULL_MAX_VERTICES * (CONVEX_HULL_MAX_VERTICES - 1)];
+
+	Vec3 half_extents; // Largest distance of a vertex from the body origin along each axis
+} ConvexHull;
+
+// Builds the hull of count points. Hulls with more than CONVEX_HULL_MAX_VERTICES vertices keep
+// the most outlying ones. Returns false if the points are all on a plane.
+bool convex_hull_build(ConvexHull* const hull, const Vec3* const points, const int count);
+
+// Index of the vertex furthest along direction, both in body space. hint is the vertex the
+// search starts from and receives the result, pass the previous result for coherent queries.
+int convex_hull_support(const ConvexHull* const hull, const Vec3 direction, int* const hint);
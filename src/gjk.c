@@ -0,0 +1,488 @@
+#include "gjk.h"
+#include "math_ops.h"
+#include <float.h>
+#include <math.h>
+
+enum {
+	GJK_MAX_ITERATIONS = 32,
+	EPA_MAX_ITERATIONS = 32,
+	EPA_MAX_VERTICES = EPA_MAX_ITERATIONS + 4,
+	EPA_MAX_FACES = 2 * EPA_MAX_VERTICES,
+	EPA_MAX_EDGES = 3 * EPA_MAX_FACES
+};
+
+// Shapes closer than this count as intersecting
+static const float GJK_DISTANCE_TOLERANCE = 1e-4f;
+// Stop once a support point improves the squared distance by less than this fraction
+static const float GJK_RELATIVE_TOLERANCE = 1e-5f;
+// Stop expanding once the polytope is this close to the Minkowski difference boundary
+static const float EPA_TOLERANCE = 1e-4f;
+
+SimplexVertex support_vertex(const ConvexProxy* const a, const ConvexProxy* const b, const Vec3 direction) {
+	SimplexVertex vertex;
+	vertex.local_a = a->support(a->shape, rotate_to_local(&a->pose.orientation, direction));
+	vertex.local_b = b->support(b->shape, rotate_to_local(&b->pose.orientation, vec3_scale(direction, -1)));
+	vertex.point_a = pose_to_world(&a->pose, vertex.local_a);
+	vertex.point_b = pose_to_world(&b->pose, vertex.local_b);
+	vertex.point = vec3_sub(vertex.point_a, vertex.point_b);
+	return vertex;
+}
+
+// Keeps the given vertices of the simplex in order, with their barycentric weights
+void simplex_reduce(GjkSimplex* const simplex, float* const weights, const int count, const int* const keep, const float* const keep_weights) {
+	SimplexVertex vertices[4];
+	for (int i = 0; i < count; i++) {
+		vertices[i] = simplex->vertices[keep[i]];
+	}
+	for (int i = 0; i < count; i++) {
+		simplex->vertices[i] = vertices[i];
+		weights[i] = keep_weights[i];
+	}
+	simplex->count = count;
+}
+
+Vec3 simplex_weighted_sum(const GjkSimplex* const simplex, const float* const weights) {
+	Vec3 point = {};
+	for (int i = 0; i < simplex->count; i++) {
+		point = vec3_add(point, vec3_scale(simplex->vertices[i].point, weights[i]));
+	}
+	return point;
+}
+
+// Closest point to the origin on the triangle of simplex vertices i, j and k. Keeps only the
+// feature of the triangle the point lies on, following the region tests from Ericson's
+// Real-Time Collision Detection.
+void simplex_solve_triangle(GjkSimplex* const simplex, float* const weights, const int i, const int j, const int k) {
+	const Vec3 a = simplex->vertices[i].point;
+	const Vec3 b = simplex->vertices[j].point;
+	const Vec3 c = simplex->vertices[k].point;
+	const Vec3 ab = vec3_sub(b, a);
+	const Vec3 ac = vec3_sub(c, a);
+
+	const float d1 = -vec3_dot(ab, a);
+	const float d2 = -vec3_dot(ac, a);
+	if (d1 <= 0 && d2 <= 0) {
+		simplex_reduce(simplex, weights, 1, (int[]){ i }, (float[]){ 1 });
+		return;
+	}
+
+	const float d3 = -vec3_dot(ab, b);
+	const float d4 = -vec3_dot(ac, b);
+	if (d3 >= 0 && d4 <= d3) {
+		simplex_reduce(simplex, weights, 1, (int[]){ j }, (float[]){ 1 });
+		return;
+	}
+
+	const float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+		const float v = d1 / (d1 - d3);
+		simplex_reduce(simplex, weights, 2, (int[]){ i, j }, (float[]){ 1 - v, v });
+		return;
+	}
+
+	const float d5 = -vec3_dot(ab, c);
+	const float d6 = -vec3_dot(ac, c);
+	if (d6 >= 0 && d5 <= d6) {
+		simplex_reduce(simplex, weights, 1, (int[]){ k }, (float[]){ 1 });
+		return;
+	}
+
+	const float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+		const float w = d2 / (d2 - d6);
+		simplex_reduce(simplex, weights, 2, (int[]){ i, k }, (float[]){ 1 - w, w });
+		return;
+	}
+
+	const float va = d3 * d6 - d5 * d4;
+	if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+		const float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		simplex_reduce(simplex, weights, 2, (int[]){ j, k }, (float[]){ 1 - w, w });
+		return;
+	}
+
+	const float denominator = 1 / (va + vb + vc);
+	const float v = vb * denominator;
+	const float w = vc * denominator;
+	simplex_reduce(simplex, weights, 3, (int[]){ i, j, k }, (float[]){ 1 - v - w, v, w });
+}
+
+// Reduces the simplex to the smallest feature holding its point closest to the origin and
+// returns that point. weights receives the barycentric coordinates of the point.
+Vec3 simplex_closest_point(GjkSimplex* const simplex, float* const weights) {
+	switch (simplex->count) {
+		case 1: {
+			weights[0] = 1;
+			break;
+		}
+		case 2: {
+			const Vec3 a = simplex->vertices[0].point;
+			const Vec3 ab = vec3_sub(simplex->vertices[1].point, a);
+			const float length_squared = vec3_dot(ab, ab);
+			const float t = length_squared > 0 ? -vec3_dot(a, ab) / length_squared : 0;
+			if (t <= 0) {
+				simplex_reduce(simplex, weights, 1, (int[]){ 0 }, (float[]){ 1 });
+			} else if (t >= 1) {
+				simplex_reduce(simplex, weights, 1, (int[]){ 1 }, (float[]){ 1 });
+			} else {
+				weights[0] = 1 - t;
+				weights[1] = t;
+			}
+			break;
+		}
+		case 3: {
+			simplex_solve_triangle(simplex, weights, 0, 1, 2);
+			break;
+		}
+		case 4: {
+			// Faces of the tetrahedron with the vertex opposite to each
+			const int faces[4][4] = { { 0, 1, 2, 3 }, { 0, 2, 3, 1 }, { 0, 3, 1, 2 }, { 1, 3, 2, 0 } };
+
+			GjkSimplex best = {};
+			float best_weights[4] = {};
+			float best_distance = FLT_MAX;
+			bool inside = true;
+
+			for (int f = 0; f < 4; f++) {
+				const Vec3 a = simplex->vertices[faces[f][0]].point;
+				const Vec3 b = simplex->vertices[faces[f][1]].point;
+				const Vec3 c = simplex->vertices[faces[f][2]].point;
+				const Vec3 d = simplex->vertices[faces[f][3]].point;
+				const Vec3 normal = vec3_cross(vec3_sub(b, a), vec3_sub(c, a));
+
+				// The origin is outside this face when it lies on the other side from the opposite
+				// vertex, a flat tetrahedron has every face count as outside
+				const float side_origin = -vec3_dot(a, normal);
+				const float side_opposite = vec3_dot(vec3_sub(d, a), normal);
+				if (side_origin * side_opposite > 0) {
+					continue;
+				}
+
+				inside = false;
+				GjkSimplex face = *simplex;
+				float face_weights[4] = {};
+				simplex_solve_triangle(&face, face_weights, faces[f][0], faces[f][1], faces[f][2]);
+				const Vec3 point = simplex_weighted_sum(&face, face_weights);
+				const float distance = vec3_dot(point, point);
+				if (distance < best_distance) {
+					best_distance = distance;
+					best = face;
+					for (int i = 0; i < face.count; i++) {
+						best_weights[i] = face_weights[i];
+					}
+				}
+			}
+
+			// No face gave a usable distance when the points are not finite, the tetrahedron is
+			// kept and counts as holding the origin
+			if (inside || best.count == 0) {
+				return (Vec3){};
+			}
+
+			*simplex = best;
+			for (int i = 0; i < best.count; i++) {
+				weights[i] = best_weights[i];
+			}
+			break;
+		}
+	}
+
+	return simplex_weighted_sum(simplex, weights);
+}
+
+GjkResult gjk_distance(const ConvexProxy* const a, const ConvexProxy* const b, GjkSimplex* const simplex, int* const iterations) {
+	GjkSimplex current = *simplex;
+
+	// The cached vertices stay valid points of the Minkowski difference when moved along with the shapes
+	for (int i = 0; i < current.count; i++) {
+		SimplexVertex* const vertex = &current.vertices[i];
+		vertex->point_a = pose_to_world(&a->pose, vertex->local_a);
+		vertex->point_b = pose_to_world(&b->pose, vertex->local_b);
+		vertex->point = vec3_sub(vertex->point_a, vertex->point_b);
+	}
+
+	if (current.count == 0) {
+		Vec3 direction = vec3_sub(b->pose.position, a->pose.position);
+		if (vec3_dot(direction, direction) == 0) {
+			direction = new_vec3(1, 0, 0);
+		}
+		current.vertices[0] = support_vertex(a, b, direction);
+		current.count = 1;
+	}
+
+	GjkResult result = {};
+	float weights[4];
+	Vec3 closest = simplex_closest_point(&current, weights);
+	bool separated = false;
+
+	for (int iteration = 0; iteration < GJK_MAX_ITERATIONS; iteration++) {
+		(*iterations)++;
+
+		const float distance_squared = vec3_dot(closest, closest);
+		if (current.count == 4 || distance_squared <= GJK_DISTANCE_TOLERANCE * GJK_DISTANCE_TOLERANCE) {
+			result.intersecting = true;
+			break;
+		}
+
+		const SimplexVertex vertex = support_vertex(a, b, vec3_scale(closest, -1));
+
+		// Converged when the support point gets no closer to the origin than the simplex
+		if (distance_squared - vec3_dot(closest, vertex.point) <= GJK_RELATIVE_TOLERANCE * distance_squared) {
+			break;
+		}
+
+		bool duplicate = false;
+		for (int i = 0; i < current.count; i++) {
+			const Vec3 offset = vec3_sub(current.vertices[i].point, vertex.point);
+			duplicate |= vec3_dot(offset, offset) == 0;
+		}
+		if (duplicate) {
+			break;
+		}
+
+		// A support point past the origin along the search direction proves the shapes apart, a
+		// nearly flat tetrahedron that still seems to hold the origin is then a rounding error
+		// and the search stops at the triangle
+		separated |= vec3_dot(closest, vertex.point) > 0;
+		if (separated && current.count == 3) {
+			GjkSimplex tetrahedron = current;
+			tetrahedron.vertices[tetrahedron.count++] = vertex;
+			float tetrahedron_weights[4];
+			const Vec3 tetrahedron_closest = simplex_closest_point(&tetrahedron, tetrahedron_weights);
+			if (tetrahedron.count == 4) {
+				break;
+			}
+
+			current = tetrahedron;
+			closest = tetrahedron_closest;
+			for (int i = 0; i < current.count; i++) {
+				weights[i] = tetrahedron_weights[i];
+			}
+			continue;
+		}
+
+		current.vertices[current.count++] = vertex;
+		closest = simplex_closest_point(&current, weights);
+	}
+
+	*simplex = current;
+
+	if (!result.intersecting) {
+		result.distance = vec3_length(closest);
+		for (int i = 0; i < current.count; i++) {
+			result.point_a = vec3_add(result.point_a, vec3_scale(current.vertices[i].point_a, weights[i]));
+			result.point_b = vec3_add(result.point_b, vec3_scale(current.vertices[i].point_b, weights[i]));
+		}
+	}
+
+	return result;
+}
+
+// Adds the support point along direction if it is further than tolerance from the feature,
+// measured by distance
+bool try_add_vertex(const ConvexProxy* const a, const ConvexProxy* const b, SimplexVertex* const vertices, int* const count, const Vec3 direction, float (*distance)(const SimplexVertex* const vertices, const Vec3 point)) {
+	const SimplexVertex vertex = support_vertex(a, b, direction);
+	if (distance(vertices, vertex.point) <= GJK_DISTANCE_TOLERANCE) {
+		return false;
+	}
+	vertices[(*count)++] = vertex;
+	return true;
+}
+
+float distance_to_point(const SimplexVertex* const vertices, const Vec3 point) {
+	return vec3_length(vec3_sub(point, vertices[0].point));
+}
+
+float distance_to_line(const SimplexVertex* const vertices, const Vec3 point) {
+	const Vec3 direction = vec3_normalize(vec3_sub(vertices[1].point, vertices[0].point));
+	return vec3_length(vec3_cross(vec3_sub(point, vertices[0].point), direction));
+}
+
+float distance_to_plane(const SimplexVertex* const vertices, const Vec3 point) {
+	const Vec3 normal = vec3_normalize(vec3_cross(vec3_sub(vertices[1].point, vertices[0].point), vec3_sub(vertices[2].point, vertices[0].point)));
+	return fabsf(vec3_dot(vec3_sub(point, vertices[0].point), normal));
+}
+
+// GJK ends early with fewer than four vertices when the shapes only touch, grow the simplex
+// into a tetrahedron with support points in directions away from its current feature
+bool complete_tetrahedron(const ConvexProxy* const a, const ConvexProxy* const b, SimplexVertex* const vertices, int* const count) {
+	if (*count == 1) {
+		const Vec3 axes[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		for (int i = 0; i < 6 && *count == 1; i++) {
+			try_add_vertex(a, b, vertices, count, axes[i], distance_to_point);
+		}
+	}
+
+	if (*count == 2) {
+		// Search perpendicular to the segment, starting from the axis it is least aligned with
+		const Vec3 direction = vec3_sub(vertices[1].point, vertices[0].point);
+		const Vec3 axis = fabsf(direction.x) < fabsf(direction.y) && fabsf(direction.x) < fabsf(direction.z) ? new_vec3(1, 0, 0) :
+			fabsf(direction.y) < fabsf(direction.z) ? new_vec3(0, 1, 0) : new_vec3(0, 0, 1);
+		const Vec3 first = vec3_cross(direction, axis);
+		const Vec3 second = vec3_cross(direction, first);
+		const Vec3 searches[4] = { first, vec3_scale(first, -1), second, vec3_scale(second, -1) };
+		for (int i = 0; i < 4 && *count == 2; i++) {
+			try_add_vertex(a, b, vertices, count, searches[i], distance_to_line);
+		}
+	}
+
+	if (*count == 3) {
+		const Vec3 normal = vec3_cross(vec3_sub(vertices[1].point, vertices[0].point), vec3_sub(vertices[2].point, vertices[0].point));
+		if (!try_add_vertex(a, b, vertices, count, normal, distance_to_plane)) {
+			try_add_vertex(a, b, vertices, count, vec3_scale(normal, -1), distance_to_plane);
+		}
+	}
+
+	return *count == 4;
+}
+
+typedef struct {
+	int indices[3]; // Counter clockwise seen from outside
+	Vec3 normal;
+	float distance; // Of the face plane from the origin
+} EpaFace;
+
+bool epa_face(EpaFace* const face, const SimplexVertex* const vertices, const int i, const int j, const int k) {
+	const Vec3 a = vertices[i].point;
+	const Vec3 normal = vec3_cross(vec3_sub(vertices[j].point, a), vec3_sub(vertices[k].point, a));
+	const float length = vec3_length(normal);
+	if (length == 0) {
+		return false;
+	}
+
+	face->indices[0] = i;
+	face->indices[1] = j;
+	face->indices[2] = k;
+	face->normal = vec3_scale(normal, 1 / length);
+	face->distance = vec3_dot(face->normal, a);
+	return true;
+}
+
+// Adds the edge to the horizon, or removes it when the neighbouring face already added it in reverse
+void horizon_add_edge(int (*const edges)[2], int* const num_edges, const int from, const int to) {
+	for (int i = 0; i < *num_edges; i++) {
+		if (edges[i][0] == to && edges[i][1] == from) {
+			edges[i][0] = edges[*num_edges - 1][0];
+			edges[i][1] = edges[*num_edges - 1][1];
+			(*num_edges)--;
+			return;
+		}
+	}
+
+	edges[*num_edges][0] = from;
+	edges[*num_edges][1] = to;
+	(*num_edges)++;
+}
+
+// Index of the face nearest the origin
+int epa_closest_face(const EpaFace* const faces, const int num_faces) {
+	int closest = 0;
+	for (int i = 1; i < num_faces; i++) {
+		if (faces[i].distance < faces[closest].distance) {
+			closest = i;
+		}
+	}
+	return closest;
+}
+
+bool epa_penetration(const ConvexProxy* const a, const ConvexProxy* const b, const GjkSimplex* const simplex, EpaResult* const result, int* const iterations) {
+	SimplexVertex vertices[EPA_MAX_VERTICES];
+	int num_vertices = simplex->count;
+	for (int i = 0; i < num_vertices; i++) {
+		vertices[i] = simplex->vertices[i];
+	}
+
+	if (!complete_tetrahedron(a, b, vertices, &num_vertices)) {
+		return false;
+	}
+
+	// Wind the tetrahedron so every face normal points away from the opposite vertex
+	const Vec3 base_normal = vec3_cross(vec3_sub(vertices[1].point, vertices[0].point), vec3_sub(vertices[2].point, vertices[0].point));
+	if (vec3_dot(base_normal, vec3_sub(vertices[3].point, vertices[0].point)) > 0) {
+		const SimplexVertex swap = vertices[1];
+		vertices[1] = vertices[2];
+		vertices[2] = swap;
+	}
+
+	EpaFace faces[EPA_MAX_FACES];
+	int num_faces = 0;
+	const int tetrahedron[4][3] = { { 0, 1, 2 }, { 0, 3, 1 }, { 0, 2, 3 }, { 1, 3, 2 } };
+	for (int i = 0; i < 4; i++) {
+		if (!epa_face(&faces[num_faces], vertices, tetrahedron[i][0], tetrahedron[i][1], tetrahedron[i][2])) {
+			return false;
+		}
+		num_faces++;
+	}
+
+	for (int iteration = 0; iteration < EPA_MAX_ITERATIONS; iteration++) {
+		(*iterations)++;
+
+		const int closest = epa_closest_face(faces, num_faces);
+		const SimplexVertex vertex = support_vertex(a, b, faces[closest].normal);
+		if (vec3_dot(vertex.point, faces[closest].normal) - faces[closest].distance <= EPA_TOLERANCE || num_vertices >= EPA_MAX_VERTICES) {
+			break;
+		}
+
+		const int new_index = num_vertices++;
+		vertices[new_index] = vertex;
+
+		// Remove every face the new vertex can see, the edges left bare form the horizon
+		int edges[EPA_MAX_EDGES][2];
+		int num_edges = 0;
+		for (int i = 0; i < num_faces; i++) {
+			const EpaFace* const face = &faces[i];
+			if (vec3_dot(face->normal, vec3_sub(vertex.point, vertices[face->indices[0]].point)) <= 0) {
+				continue;
+			}
+
+			for (int e = 0; e < 3; e++) {
+				horizon_add_edge(edges, &num_edges, face->indices[e], face->indices[(e + 1) % 3]);
+			}
+
+			faces[i--] = faces[--num_faces];
+		}
+
+		if (num_faces + num_edges > EPA_MAX_FACES) {
+			return false;
+		}
+
+		for (int e = 0; e < num_edges; e++) {
+			if (epa_face(&faces[num_faces], vertices, edges[e][0], edges[e][1], new_index)) {
+				num_faces++;
+			}
+		}
+
+		if (num_faces == 0) {
+			return false;
+		}
+	}
+
+	// Closest point of the polytope to the origin, split into the points on both shapes
+	// through its barycentric coordinates on the face. Without convergence the last pass
+	// replaced faces, so the closest one is looked up again.
+	const EpaFace* const face = &faces[epa_closest_face(faces, num_faces)];
+	const SimplexVertex* const v0 = &vertices[face->indices[0]];
+	const SimplexVertex* const v1 = &vertices[face->indices[1]];
+	const SimplexVertex* const v2 = &vertices[face->indices[2]];
+	const Vec3 point = vec3_scale(face->normal, face->distance);
+
+	const Vec3 e0 = vec3_sub(v1->point, v0->point);
+	const Vec3 e1 = vec3_sub(v2->point, v0->point);
+	const Vec3 e2 = vec3_sub(point, v0->point);
+	const float d00 = vec3_dot(e0, e0);
+	const float d01 = vec3_dot(e0, e1);
+	const float d11 = vec3_dot(e1, e1);
+	const float d20 = vec3_dot(e2, e0);
+	const float d21 = vec3_dot(e2, e1);
+	const float denominator = d00 * d11 - d01 * d01;
+	const float v = denominator != 0 ? (d11 * d20 - d01 * d21) / denominator : 0;
+	const float w = denominator != 0 ? (d00 * d21 - d01 * d20) / denominator : 0;
+	const float u = 1 - v - w;
+
+	result->normal = vec3_scale(face->normal, -1);
+	// Shapes that only touch can leave the origin just outside the polytope
+	result->depth = fmaxf(face->distance, 0);
+	result->point_a = vec3_add(vec3_add(vec3_scale(v0->point_a, u), vec3_scale(v1->point_a, v)), vec3_scale(v2->point_a, w));
+	result->point_b = vec3_add(vec3_add(vec3_scale(v0->point_b, u), vec3_scale(v1->point_b, v)), vec3_scale(v2->point_b, w));
+	return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include "physics.h"
+
+// GJK distance and EPA penetration depth between two convex shapes given only by their
+// support mappings. Shapes are described in body space and placed in the world by a pose.
+
+// Body space point of the shape furthest along a body space direction
+typedef Vec3 (*ConvexSupport)(void* const shape, const Vec3 direction);
+
+typedef struct {
+	ConvexSupport support;
+	void* shape;
+	Pose pose;
+} ConvexProxy;
+
+typedef struct {
+	// Support points in the body space of each shape, enough to rebuild the vertex after the shapes moved
+	Vec3 local_a;
+	Vec3 local_b;
+
+	// World space
+	Vec3 point_a;
+	Vec3 point_b;
+	Vec3 point; // point_a - point_b, a point of the Minkowski difference
+} SimplexVertex;
+
+typedef struct {
+	SimplexVertex vertices[4];
+	int count;
+} GjkSimplex;
+
+typedef struct {
+	bool intersecting;
+	float distance; // 0 when intersecting
+	Vec3 point_a; // Closest points on each shape in world space, only set when not intersecting
+	Vec3 point_b;
+} GjkResult;
+
+typedef struct {
+	Vec3 normal; // Points from b towards a, moving a along it by depth separates the shapes
+	float depth;
+	Vec3 point_a; // Deepest points on each shape in world space
+	Vec3 point_b;
+} EpaResult;
+
+// simplex warm starts the query and receives the final simplex, a count of 0 starts cold.
+// Vertices of a warm start are rebuilt from their body space points at the current poses.
+// iterations is advanced by the iterations run, job threads pass a counter of their own.
+GjkResult gjk_distance(const ConvexProxy* const a, const ConvexProxy* const b, GjkSimplex* const simplex, int* const iterations);
+
+// Penetration of two intersecting shapes, expanding the simplex gjk_distance finished with.
+// Returns false when no polytope with volume can be built, which only happens for shapes that barely touch.
+// iterations is advanced like in gjk_distance.
+bool epa_penetration(const ConvexProxy* const a, const ConvexProxy* const b, const GjkSimplex* const simplex, EpaResult* const result, int* const iterations);
@@ -0,0 +1,136 @@
+#include "heightfield.h"
+#include "broadphase.h"
+#include <math.h>
+
+bool heightfield_init(Heightfield* const heightfield, const uint16_t* const heights, const int num_columns, const int num_rows, const float cell_size, const float height_scale, const float height_offset) {
+	*heightfield = (Heightfield){};
+	if (num_columns < 2 || num_rows < 2 || cell_size <= 0) {
+		return false;
+	}
+
+	heightfield->heights = heights;
+	heightfield->num_columns = num_columns;
+	heightfield->num_rows = num_rows;
+	heightfield->cell_size = cell_size;
+	heightfield->height_scale = height_scale;
+	heightfield->height_offset = height_offset;
+	heightfield->half_extents = (Vec3){
+		(num_columns - 1) * cell_size / 2,
+		fmaxf(fabsf(height_offset), fabsf(height_offset + UINT16_MAX * height_scale)),
+		(num_rows - 1) * cell_size / 2
+	};
+	return true;
+}
+
+bool heightfield_from_memory(Heightfield* const heightfield, const void* const data, const size_t size) {
+	*heightfield = (Heightfield){};
+	if (size < sizeof(HeightfieldHeader)) {
+		return false;
+	}
+
+	const HeightfieldHeader* const header = data;
+	if (header->magic != HEIGHTFIELD_MAGIC || header->num_columns > INT32_MAX || header->num_rows > INT32_MAX) {
+		return false;
+	}
+
+	const size_t num_samples = (size_t)header->num_columns * header->num_rows;
+	if ((size - sizeof(HeightfieldHeader)) / sizeof(uint16_t) < num_samples) {
+		return false;
+	}
+
+	return heightfield_init(heightfield, (const uint16_t*)(header + 1), header->num_columns, header->num_rows, header->cell_size, header->height_scale, header->height_offset);
+}
+
+bool heightfield_cell_range(const Heightfield* const heightfield, const Vec3 min, const Vec3 max, int* const first_column, int* const first_row, int* const last_column, int* const last_row) {
+	const float inverse_cell_size = 1 / heightfield->cell_size;
+	const float first_x = floorf((min.x + heightfield->half_extents.x) * inverse_cell_size);
+	const float first_z = floorf((min.z + heightfield->half_extents.z) * inverse_cell_size);
+	const float last_x = floorf((max.x + heightfield->half_extents.x) * inverse_cell_size);
+	const float last_z = floorf((max.z + heightfield->half_extents.z) * inverse_cell_size);
+
+	// Clamp in floats first, a far away body would overflow the conversion
+	const int num_cells_x = heightfield->num_columns - 1;
+	const int num_cells_z = heightfield->num_rows - 1;
+	if (last_x < 0 || last_z < 0 || first_x >= num_cells_x || first_z >= num_cells_z) {
+		return false;
+	}
+
+	*first_column = first_x > 0 ? (int)first_x : 0;
+	*first_row = first_z > 0 ? (int)first_z : 0;
+	*last_column = last_x < num_cells_x - 1 ? (int)last_x : num_cells_x - 1;
+	*last_row = last_z < num_cells_z - 1 ? (int)last_z : num_cells_z - 1;
+	return true;
+}
+
+bool heightfield_cell_triangles(const Heightfield* const heightfield, const int column, const int row, const float min_height, Vec3 triangles[2][3]) {
+	const uint16_t* const samples = heightfield->heights + (size_t)row * heightfield->num_columns + column;
+	const uint16_t quantized[4] = { samples[0], samples[1], samples[heightfield->num_columns], samples[heightfield->num_columns + 1] };
+
+	Vec3 corners[4];
+	bool above = false;
+	for (int i = 0; i < 4; i++) {
+		corners[i].x = (column + (i & 1)) * heightfield->cell_size - heightfield->half_extents.x;
+		corners[i].y = heightfield->height_offset + quantized[i] * heightfield->height_scale;
+		corners[i].z = (row + (i >> 1)) * heightfield->cell_size - heightfield->half_extents.z;
+		above |= corners[i].y >= min_height;
+	}
+
+	if (!above) {
+		return false;
+	}
+
+	// Corners 0 and 3 are diagonal, both triangles face +y
+	triangles[0][0] = corners[0];
+	triangles[0][1] = corners[2];
+	triangles[0][2] = corners[1];
+	triangles[1][0] = corners[1];
+	triangles[1][1] = corners[2];
+	triangles[1][2] = corners[3];
+	return true;
+}
+
+float heightfield_cast(const Heightfield* const heightfield, const Vec3 origin, const Vec3 direction, float max_distance, const Vec3 inflate, const TriangleCastCallback callback, void* const context) {
+	const Vec3 inverse_direction = { 1 / direction.x, 1 / direction.y, 1 / direction.z };
+	const Vec3 half_extents = heightfield->half_extents;
+	const Vec3 max = { half_extents.x + inflate.x, half_extents.y + inflate.y, half_extents.z + inflate.z };
+	const Vec3 min = { -max.x, -max.y, -max.z };
+
+	float t;
+	float leave;
+	if (!ray_intersects_aabb(origin, inverse_direction, max_distance, min, max, &t, &leave)) {
+		return max_distance;
+	}
+
+	// A step covers about one cell horizontally, a vertical ray stays in one cell all the way
+	const float horizontal_length = sqrtf(direction.x * direction.x + direction.z * direction.z);
+	const float step = heightfield->cell_size / fmaxf(horizontal_length, 1e-6f);
+
+	while (t <= fminf(leave, max_distance)) {
+		const float t_end = fminf(t + step, fminf(leave, max_distance));
+		const Vec3 start = { origin.x + direction.x * t, origin.y + direction.y * t, origin.z + direction.z * t };
+		const Vec3 end = { origin.x + direction.x * t_end, origin.y + direction.y * t_end, origin.z + direction.z * t_end };
+		const Vec3 segment_min = { fminf(start.x, end.x) - inflate.x, fminf(start.y, end.y) - inflate.y, fminf(start.z, end.z) - inflate.z };
+		const Vec3 segment_max = { fmaxf(start.x, end.x) + inflate.x, fmaxf(start.y, end.y) + inflate.y, fmaxf(start.z, end.z) + inflate.z };
+
+		int first_column, first_row, last_column, last_row;
+		if (heightfield_cell_range(heightfield, segment_min, segment_max, &first_column, &first_row, &last_column, &last_row)) {
+			for (int row = first_row; row <= last_row; row++) {
+				for (int column = first_column; column <= last_column; column++) {
+					Vec3 triangles[2][3];
+					if (!heightfield_cell_triangles(heightfield, column, row, segment_min.y, triangles)) {
+						continue;
+					}
+					max_distance = callback(context, triangles[0], max_distance);
+					max_distance = callback(context, triangles[1], max_distance);
+				}
+			}
+		}
+
+		if (t_end >= fminf(leave, max_distance)) {
+			break;
+		}
+		t = t_end;
+	}
+
+	return max_distance;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "math_types.h"
+#include "mesh.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Heightfield terrain collider: a grid of heights quantized to 16 bits, stored row after row
+// with height = height_offset + sample * height_scale. The grid is centered on its body in x
+// and z. Cells are found directly from coordinates, so no hierarchy is built.
+
+enum { HEIGHTFIELD_MAGIC = 0x444c4648 }; // "HFLD"
+
+// Layout of a heightfield file in native byte order. The samples follow the header directly,
+// so a mapped file can be used in place.
+typedef struct {
+	uint32_t magic;
+	uint32_t num_columns; // Samples along x
+	uint32_t num_rows; // Samples along z
+	float cell_size;
+	float height_scale;
+	float height_offset;
+} HeightfieldHeader;
+
+typedef struct {
+	const uint16_t* heights; // Owned by the caller, may point into a mapped file
+	int num_columns;
+	int num_rows;
+	float cell_size;
+	float height_scale;
+	float height_offset;
+	Vec3 half_extents; // Covers the whole quantized range, so the samples are never scanned
+} Heightfield;
+
+// Returns false for grids smaller than one cell
+bool heightfield_init(Heightfield* const heightfield, const uint16_t* const heights, const int num_columns, const int num_rows, const float cell_size, const float height_scale, const float height_offset);
+
+// Points the heightfield at a header and its samples, without copying them. Returns false when
+// the data is too short or not a heightfield.
+bool heightfield_from_memory(Heightfield* const heightfield, const void* const data, const size_t size);
+
+// Range of cells under a body space box, false when it misses the grid
+bool heightfield_cell_range(const Heightfield* const heightfield, const Vec3 min, const Vec3 max, int* const first_column, int* const first_row, int* const last_column, int* const last_row);
+
+// Body space corners of a cell as two triangles, counter clockwise seen from above. Returns
+// false when the whole cell is below min_height, so nothing above it can touch the cell.
+bool heightfield_cell_triangles(const Heightfield* const heightfield, const int column, const int row, const float min_height, Vec3 triangles[2][3]);
+
+// Runs callback on the triangles of the cells the body space ray origin + t * direction passes
+// over before max_distance, with the ray grown by inflate for swept shapes. The ray is walked
+// in steps of about a cell, cells are skipped once a callback returned a distance before them.
+// Returns the last distance.
+float heightfield_cast(const Heightfield* const heightfield, const Vec3 origin, const Vec3 direction, float max_distance, const Vec3 inflate, const TriangleCastCallback callback, void* const context);
@@ -0,0 +1,16 @@
+#pragma once
+
+// Pool of worker threads for loops over many independent items. The pool starts on first use
+// with one worker less than there are cores, and the calling thread takes items too.
+
+enum { JOBS_MAX_WORKERS = 31 };
+
+// Runs on the items [first, first + count)
+typedef void (*JobFunction)(void* const context, const int first, const int count);
+
+// Threads that take part in a parallel for, the workers and the caller
+int jobs_num_threads();
+
+// Hands out count items to the threads batch_size at a time, returns when all of them are done.
+// Only one thread may call it at a time, and never from inside a job.
+void jobs_parallel_for(const int count, const int batch_size, const JobFunction function, void* const context);
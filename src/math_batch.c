@@ -0,0 +1,92 @@
+#include "math_batch.h"
+#include "math_simd.h"
+#include <float.h>
+
+void points_transform(PointsSoA out, const Vec3* const points, const int count, const Mat4* const transform) {
+	const Mat3 linear = {
+		.m = {
+			{ transform->m[0][0], transform->m[0][1], transform->m[0][2] },
+			{ transform->m[1][0], transform->m[1][1], transform->m[1][2] },
+			{ transform->m[2][0], transform->m[2][1], transform->m[2][2] }
+		}
+	};
+	const Vec3 translation = { transform->m[0][3], transform->m[1][3], transform->m[2][3] };
+	points_transform_affine(out, points, count, &linear, translation);
+}
+
+void points_transform_affine(PointsSoA out, const Vec3* const points, const int count, const Mat3* const linear, const Vec3 translation) {
+	const float (*const m)[3] = linear->m;
+	const float t[3] = { translation.x, translation.y, translation.z };
+	int i = 0;
+
+#ifdef KINESIS_SIMD_SSE
+	for (; i + 4 <= count; i += 4) {
+		const Vec4x x = _mm_set_ps(points[i + 3].x, points[i + 2].x, points[i + 1].x, points[i].x);
+		const Vec4x y = _mm_set_ps(points[i + 3].y, points[i + 2].y, points[i + 1].y, points[i].y);
+		const Vec4x z = _mm_set_ps(points[i + 3].z, points[i + 2].z, points[i + 1].z, points[i].z);
+
+		float* const outputs[3] = { out.x, out.y, out.z };
+		for (int row = 0; row < 3; row++) {
+			Vec4x result = _mm_mul_ps(_mm_set1_ps(m[row][0]), x);
+			result = vec4x_madd(_mm_set1_ps(m[row][1]), y, result);
+			result = vec4x_madd(_mm_set1_ps(m[row][2]), z, result);
+			_mm_storeu_ps(outputs[row] + i, _mm_add_ps(result, _mm_set1_ps(t[row])));
+		}
+	}
+#endif
+
+	for (; i < count; i++) {
+		const Vec3 point = points[i];
+		out.x[i] = m[0][0] * point.x + m[0][1] * point.y + m[0][2] * point.z + t[0];
+		out.y[i] = m[1][0] * point.x + m[1][1] * point.y + m[1][2] * point.z + t[1];
+		out.z[i] = m[2][0] * point.x + m[2][1] * point.y + m[2][2] * point.z + t[2];
+	}
+}
+
+void points_project(const PointsSoA points, const int count, const Vec3* const axes, const int num_axes, float* const mins, float* const maxs) {
+	for (int axis_index = 0; axis_index < num_axes; axis_index++) {
+		const Vec3 axis = axes[axis_index];
+		float min = FLT_MAX;
+		float max = -FLT_MAX;
+		int i = 0;
+
+#ifdef KINESIS_SIMD_SSE
+		if (count >= 4) {
+			const Vec4x axis_x = _mm_set1_ps(axis.x);
+			const Vec4x axis_y = _mm_set1_ps(axis.y);
+			const Vec4x axis_z = _mm_set1_ps(axis.z);
+			Vec4x min4 = _mm_set1_ps(FLT_MAX);
+			Vec4x max4 = _mm_set1_ps(-FLT_MAX);
+
+			for (; i + 4 <= count; i += 4) {
+				Vec4x projection = _mm_mul_ps(_mm_loadu_ps(points.x + i), axis_x);
+				projection = vec4x_madd(_mm_loadu_ps(points.y + i), axis_y, projection);
+				projection = vec4x_madd(_mm_loadu_ps(points.z + i), axis_z, projection);
+				min4 = _mm_min_ps(min4, projection);
+				max4 = _mm_max_ps(max4, projection);
+			}
+
+			// Horizontal min/max of the four lanes
+			min4 = _mm_min_ps(min4, _mm_shuffle_ps(min4, min4, _MM_SHUFFLE(1, 0, 3, 2)));
+			min4 = _mm_min_ps(min4, _mm_shuffle_ps(min4, min4, _MM_SHUFFLE(2, 3, 0, 1)));
+			max4 = _mm_max_ps(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(1, 0, 3, 2)));
+			max4 = _mm_max_ps(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(2, 3, 0, 1)));
+			min = _mm_cvtss_f32(min4);
+			max = _mm_cvtss_f32(max4);
+		}
+#endif
+
+		for (; i < count; i++) {
+			const float projection = points.x[i] * axis.x + points.y[i] * axis.y + points.z[i] * axis.z;
+			min = projection < min ? projection : min;
+			max = projection > max ? projection : max;
+		}
+
+		mins[axis_index] = min;
+		maxs[axis_index] = max;
+	}
+}
+
+Vec3 points_get(const PointsSoA points, const int index) {
+	return (Vec3){ points.x[index], points.y[index], points.z[index] };
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "math_types.h"
+
+// Batched point kernels for the narrowphase. Points are stored as structure of arrays
+// (separate x, y and z arrays) so the SIMD backend processes four points per instruction.
+
+typedef struct {
+	float* x;
+	float* y;
+	float* z;
+} PointsSoA;
+
+// Transforms count points (w = 1) by transform into out, out must not alias points
+void points_transform(PointsSoA out, const Vec3* const points, const int count, const Mat4* const transform);
+
+// Same as points_transform for the affine transform linear * point + translation
+void points_transform_affine(PointsSoA out, const Vec3* const points, const int count, const Mat3* const linear, const Vec3 translation);
+
+// Projects count points onto each of num_axes axes, writing the min and max projection per axis
+void points_project(const PointsSoA points, const int count, const Vec3* const axes, const int num_axes, float* const mins, float* const maxs);
+
+Vec3 points_get(const PointsSoA points, const int index);
@@ -1,4 +1,6 @@
 #include "math_helper.h"
+#include <math.h>
+#include <string.h>
 
 float rad(float deg) {
 	return deg * PI / 180.f;
@@ -7,3 +9,45 @@ float rad(float deg) {
 float deg(float rad) {
 	return rad * 180.f / PI;
 }
+
+uint16_t float_to_half(const float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+	const uint32_t magnitude = bits & 0x7fffffff;
+
+	// Infinity and NaN, NaN keeps a quiet bit
+	if (magnitude >= 0x7f800000) {
+		return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);
+	}
+	// 65520 and up round past the largest half
+	if (magnitude >= 0x477ff000) {
+		return sign | 0x7c00;
+	}
+	// Below 2^-14 the half is denormal, in steps of 2^-24
+	if (magnitude < 0x38800000) {
+		return sign | (uint16_t)rintf(fabsf(value) * 16777216.0f);
+	}
+
+	// Rebias the exponent from 127 to 15 and round the 13 dropped mantissa bits to nearest even,
+	// a carry moves into the exponent as it should
+	return sign | (uint16_t)((magnitude - 0x38000000 + 0xfff + ((magnitude >> 13) & 1)) >> 13);
+}
+
+float half_to_float(const uint16_t half) {
+	const uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	const uint32_t exponent = (half >> 10) & 0x1f;
+	const uint32_t mantissa = half & 0x3ff;
+
+	if (exponent == 0) {
+		const float value = mantissa / 16777216.0f;
+		return sign ? -value : value;
+	}
+
+	const uint32_t bits = exponent == 0x1f
+		? sign | 0x7f800000 | (mantissa << 13)
+		: sign | ((exponent + 112) << 23) | (mantissa << 13);
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <stdint.h>
+
 static const float PI = 3.1415927f;
 
 float rad(float deg);
 float deg(float rad);
+
+// IEEE 754 half precision, rounded to nearest even. Values past 65504 become infinity.
+uint16_t float_to_half(const float value);
+float half_to_float(const uint16_t half);
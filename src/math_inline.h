@@ -0,0 +1,14 @@
+// Pulls in every math definition as static inline for KINESIS_INLINE_MATH builds. Included from
+// the bottom of vector.h, matrix.h and math_ops.h, the definitions are emitted once all three
+// headers have finished declaring, since they call into each other.
+
+#include "vector.h"
+#include "matrix.h"
+#include "math_ops.h"
+
+#if defined(MATH_VECTOR_DECLARED) && defined(MATH_MATRIX_DECLARED) && defined(MATH_OPS_DECLARED) && !defined(MATH_INLINE_DEFINED)
+#define MATH_INLINE_DEFINED
+#include "vector_impl.h"
+#include "math_ops_impl.h"
+#include "matrix_impl.h"
+#endif
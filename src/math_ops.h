@@ -3,24 +3,31 @@
 #include "matrix.h"
 
 // Mat3
-Mat3 mat3_mul(const Mat3* const a, const Mat3* const b);
-Mat3 mat3_mul_float(const Mat3* const matrix, const float scalar);
+MATH_API Mat3 mat3_mul(const Mat3* const a, const Mat3* const b);
+MATH_API Mat3 mat3_mul_float(const Mat3* const matrix, const float scalar);
 
 // Mat4
-Mat4 mat4_mul(const Mat4 a, const Mat4 b);
+MATH_API Mat4 mat4_mul(const Mat4 a, const Mat4 b);
+MATH_API void mat4_mul_into(Mat4* const result, const Mat4* const a, const Mat4* const b);
 
 // Vec2
-Vec2 vec2_sub(const Vec2 a, const Vec2 b);
+MATH_API Vec2 vec2_sub(const Vec2 a, const Vec2 b);
 
 // Vec3
-Vec3 vec3_add(const Vec3 a, const Vec3 b);
-Vec3 vec3_sub(Vec3 a, const Vec3 b);
-Vec3 vec3_cross(const Vec3 a, const Vec3 b);
-Vec3 vec3_scale(const Vec3 a, const float b);
-Vec3 vec3_div(const Vec3 a, const float b);
-float vec3_dot(const Vec3 a, const Vec3 b);
-Vec3 vec3_mul_mat3(const Vec3 a, const Mat3* const b);
-Vec3 vec3_mul_mat4(const Vec3 vec3, const Mat4* const mat4);
+MATH_API Vec3 vec3_add(const Vec3 a, const Vec3 b);
+MATH_API Vec3 vec3_sub(Vec3 a, const Vec3 b);
+MATH_API Vec3 vec3_cross(const Vec3 a, const Vec3 b);
+MATH_API Vec3 vec3_scale(const Vec3 a, const float b);
+MATH_API Vec3 vec3_mul(const Vec3 a, const Vec3 b);
+MATH_API Vec3 vec3_div(const Vec3 a, const float b);
+MATH_API float vec3_dot(const Vec3 a, const Vec3 b);
+MATH_API Vec3 vec3_mul_mat3(const Vec3 a, const Mat3* const b);
+MATH_API Vec3 vec3_mul_mat4(const Vec3 vec3, const Mat4* const mat4);
 
 // Vec4
-Vec4 vec4_mul_mat4(const Vec4 vec4, const Mat4* const mat4);
+MATH_API Vec4 vec4_mul_mat4(const Vec4 vec4, const Mat4* const mat4);
+
+#define MATH_OPS_DECLARED
+#ifdef KINESIS_INLINE_MATH
+#include "math_inline.h"
+#endif
@@ -0,0 +1,167 @@
+#pragma once
+
+// Definitions for math_ops.h, compiled by math_ops.c or inlined with KINESIS_INLINE_MATH
+
+#include "math_ops.h"
+#include "math_simd.h"
+
+MATH_API Vec2 vec2_sub(const Vec2 a, const Vec2 b) {
+	return (Vec2){
+		a.x - b.x,
+		a.y - b.y
+	};
+}
+
+MATH_API Vec3 vec3_add(const Vec3 a, const Vec3 b) {
+	return (Vec3){
+		a.x + b.x,
+		a.y + b.y,
+		a.z + b.z
+	};
+}
+
+MATH_API Vec3 vec3_sub(Vec3 a, const Vec3 b) {
+	a.x -= b.x;
+	a.y -= b.y;
+	a.z -= b.z;
+	return a;
+}
+
+MATH_API float vec3_dot(const Vec3 a, const Vec3 b) {
+#ifdef KINESIS_SIMD_SSE
+	return vec4x_x(vec4x_dot3(vec4x_from_vec3(a), vec4x_from_vec3(b)));
+#else
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+#endif
+}
+
+MATH_API Vec3 vec3_cross(const Vec3 a, const Vec3 b) {
+#ifdef KINESIS_SIMD_SSE
+	return vec4x_to_vec3(vec4x_cross3(vec4x_from_vec3(a), vec4x_from_vec3(b)));
+#else
+	Vec3 c;
+	c.x = a.y * b.z - a.z * b.y;
+	c.y = a.z * b.x - a.x * b.z;
+	c.z = a.x * b.y - a.y * b.x;
+	return c;
+#endif
+}
+
+MATH_API Vec3 vec3_scale(const Vec3 a, const float b) {
+	return (Vec3){
+		a.x * b,
+		a.y * b,
+		a.z * b
+	};
+}
+
+// Component-wise product
+MATH_API Vec3 vec3_mul(const Vec3 a, const Vec3 b) {
+	return (Vec3){
+		a.x * b.x,
+		a.y * b.y,
+		a.z * b.z
+	};
+}
+
+MATH_API Vec3 vec3_div(const Vec3 a, const float b) {
+	return (Vec3){
+		a.x / b,
+		a.y / b,
+		a.z / b
+	};
+}
+
+MATH_API Vec3 vec3_mul_mat3(const Vec3 a, const Mat3* const b) {
+	return (Vec3){
+		a.x * b->m[0][0] + a.y * b->m[0][1] + a.z * b->m[0][2],
+		a.x * b->m[1][0] + a.y * b->m[1][1] + a.z * b->m[1][2],
+		a.x * b->m[2][0] + a.y * b->m[2][1] + a.z * b->m[2][2]
+	};
+}
+
+MATH_API Vec3 vec3_mul_mat4(const Vec3 vec3, const Mat4* const mat4) {
+#ifdef KINESIS_SIMD_SSE
+	const Vec4x point = _mm_set_ps(1, vec3.z, vec3.y, vec3.x);
+	return vec4x_to_vec3(mat4x_mul_vec4x(mat4, point));
+#else
+	Vec3 result_vector = {};
+	float* const result = (float*)&result_vector;
+
+	for (int i = 0; i < 3; i++) {
+		result[i] = mat4->m[i][0] * vec3.x + mat4->m[i][1] * vec3.y + mat4->m[i][2] * vec3.z + mat4->m[i][3];
+	}
+
+	return result_vector;
+#endif
+}
+
+MATH_API Mat3 mat3_mul(const Mat3* const a, const Mat3* const b) {
+	Mat3 result = {};
+
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			for (int k = 0; k < 3; k++) {
+				result.m[i][j] += a->m[i][k] * b->m[k][j];
+			}
+		}
+	}
+
+	return result;
+}
+
+MATH_API Mat3 mat3_mul_float(const Mat3* const matrix, const float scalar) {
+	Mat3 result;
+
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			result.m[i][j] = matrix->m[i][j] * scalar;
+		}
+	}
+
+	return result;
+}
+
+MATH_API Mat4 mat4_mul(const Mat4 a, const Mat4 b) {
+	Mat4 result;
+	mat4_mul_into(&result, &a, &b);
+	return result;
+}
+
+// Result may alias a or b
+MATH_API void mat4_mul_into(Mat4* const result, const Mat4* const a, const Mat4* const b) {
+#ifdef KINESIS_SIMD_SSE
+	Mat4 product;
+	mat4x_mul(&product, a, b);
+	*result = product;
+#else
+	Mat4 product = {};
+
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			for (int k = 0; k < 4; k++) {
+				product.m[i][j] += a->m[i][k] * b->m[k][j];
+			}
+		}
+	}
+
+	*result = product;
+#endif
+}
+
+MATH_API Vec4 vec4_mul_mat4(const Vec4 vec4, const Mat4* const mat4) {
+#ifdef KINESIS_SIMD_SSE
+	Vec4 result_vector;
+	vec4x_store(&result_vector, mat4x_mul_vec4x(mat4, vec4x_load(&vec4)));
+	return result_vector;
+#else
+	Vec4 result_vector = {};
+	float* const result = (float*)&result_vector;
+
+	for (int i = 0; i < 4; i++) {
+		result[i] = mat4->m[i][0] * vec4.x + mat4->m[i][1] * vec4.y + mat4->m[i][2] * vec4.z + mat4->m[i][3] * vec4.w;
+	}
+
+	return result_vector;
+#endif
+}
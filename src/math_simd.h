@@ -0,0 +1,101 @@
+#pragma once
+
+// SSE/AVX2 helpers behind the optional SIMD math backend. Selected at compile time with
+// KINESIS_SIMD_SSE (SSE2) and KINESIS_SIMD_AVX2 (adds FMA), see the KINESIS_SIMD CMake option.
+// Values live in __m128 registers as (x, y, z, w), Vec3 loads set w to 0.
+
+#include "math_types.h"
+
+#ifdef KINESIS_SIMD_SSE
+
+#include <immintrin.h>
+
+typedef __m128 Vec4x;
+
+static inline Vec4x vec4x_load(const Vec4* const vec4) {
+	return _mm_loadu_ps(&vec4->x);
+}
+
+static inline void vec4x_store(Vec4* const vec4, const Vec4x value) {
+	_mm_storeu_ps(&vec4->x, value);
+}
+
+static inline Vec4x vec4x_from_vec3(const Vec3 vec3) {
+	return _mm_set_ps(0, vec3.z, vec3.y, vec3.x);
+}
+
+static inline Vec3 vec4x_to_vec3(const Vec4x value) {
+	float values[4];
+	_mm_storeu_ps(values, value);
+	return (Vec3){ values[0], values[1], values[2] };
+}
+
+static inline float vec4x_x(const Vec4x value) {
+	return _mm_cvtss_f32(value);
+}
+
+// a * b + c, fused on AVX2 targets
+static inline Vec4x vec4x_madd(const Vec4x a, const Vec4x b, const Vec4x c) {
+#ifdef KINESIS_SIMD_AVX2
+	return _mm_fmadd_ps(a, b, c);
+#else
+	return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+
+// Dot product of the xyz lanes, broadcast to all lanes
+static inline Vec4x vec4x_dot3(const Vec4x a, const Vec4x b) {
+	const Vec4x product = _mm_mul_ps(a, b);
+	const Vec4x x = _mm_shuffle_ps(product, product, _MM_SHUFFLE(0, 0, 0, 0));
+	const Vec4x y = _mm_shuffle_ps(product, product, _MM_SHUFFLE(1, 1, 1, 1));
+	const Vec4x z = _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 2, 2, 2));
+	return _mm_add_ps(_mm_add_ps(x, y), z);
+}
+
+static inline Vec4x vec4x_cross3(const Vec4x a, const Vec4x b) {
+	const Vec4x a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+	const Vec4x b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+	const Vec4x c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+	return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+// Leaves zero length vectors unchanged, like vec3_normalize
+static inline Vec4x vec4x_normalize3(const Vec4x value) {
+	const Vec4x length = _mm_sqrt_ps(vec4x_dot3(value, value));
+	const Vec4x mask = _mm_cmpgt_ps(length, _mm_setzero_ps());
+	const Vec4x normalized = _mm_div_ps(value, length);
+	return _mm_or_ps(_mm_and_ps(mask, normalized), _mm_andnot_ps(mask, value));
+}
+
+// Row i of the result is the sum of b's rows weighted by the broadcast elements of a's row i
+static inline void mat4x_mul(Mat4* const result, const Mat4* const a, const Mat4* const b) {
+	const Vec4x b0 = _mm_loadu_ps(b->m[0]);
+	const Vec4x b1 = _mm_loadu_ps(b->m[1]);
+	const Vec4x b2 = _mm_loadu_ps(b->m[2]);
+	const Vec4x b3 = _mm_loadu_ps(b->m[3]);
+
+	for (int i = 0; i < 4; i++) {
+		Vec4x row = _mm_mul_ps(_mm_set1_ps(a->m[i][0]), b0);
+		row = vec4x_madd(_mm_set1_ps(a->m[i][1]), b1, row);
+		row = vec4x_madd(_mm_set1_ps(a->m[i][2]), b2, row);
+		row = vec4x_madd(_mm_set1_ps(a->m[i][3]), b3, row);
+		_mm_storeu_ps(result->m[i], row);
+	}
+}
+
+// Column vector product matrix * value, computed from the transposed rows
+static inline Vec4x mat4x_mul_vec4x(const Mat4* const matrix, const Vec4x value) {
+	Vec4x r0 = _mm_loadu_ps(matrix->m[0]);
+	Vec4x r1 = _mm_loadu_ps(matrix->m[1]);
+	Vec4x r2 = _mm_loadu_ps(matrix->m[2]);
+	Vec4x r3 = _mm_loadu_ps(matrix->m[3]);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+	Vec4x result = _mm_mul_ps(r0, _mm_shuffle_ps(value, value, _MM_SHUFFLE(0, 0, 0, 0)));
+	result = vec4x_madd(r1, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 1, 1, 1)), result);
+	result = vec4x_madd(r2, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 2, 2, 2)), result);
+	result = vec4x_madd(r3, _mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 3, 3, 3)), result);
+	return result;
+}
+
+#endif
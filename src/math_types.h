@@ -0,0 +1,46 @@
+#pragma once
+
+// Vec4 and Mat4 are 16 byte aligned when the SIMD math backend is enabled
+#ifdef KINESIS_SIMD_SSE
+#if defined(_MSC_VER)
+#define MATH_ALIGN16 __declspec(align(16))
+#else
+#define MATH_ALIGN16 __attribute__((aligned(16)))
+#endif
+#else
+#define MATH_ALIGN16
+#endif
+
+typedef struct {
+	float x;
+	float y;
+} Vec2;
+
+typedef struct {
+	float x;
+	float y;
+	float z;
+} Vec3;
+
+typedef struct MATH_ALIGN16 {
+	float x;
+	float y;
+	float z;
+	float w;
+} Vec4;
+
+typedef struct {
+	float m[3][3];
+} Mat3;
+
+typedef struct MATH_ALIGN16 {
+	float m[4][4];
+} Mat4;
+
+// The math routines are compiled into math_ops.c/vector.c/matrix.c by default. With
+// KINESIS_INLINE_MATH they are static inline functions pulled in through math_inline.h.
+#ifdef KINESIS_INLINE_MATH
+#define MATH_API static inline
+#else
+#define MATH_API
+#endif
@@ -0,0 +1,280 @@
+#include "mesh.h"
+#include "broadphase.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Nodes with this many triangles or fewer always become leaves, larger ones only when the
+// surface area heuristic prefers it. The node packs the count into 4 bits.
+enum {
+	MESH_LEAF_TRIANGLES = 4,
+	MESH_LEAF_MAX_TRIANGLES = 15
+};
+
+// Cost of visiting a node relative to testing one triangle
+static const float MESH_TRAVERSAL_COST = 1.f;
+
+typedef struct {
+	Vec3 min;
+	Vec3 max;
+	Vec3 centroid;
+} TriangleBounds;
+
+typedef struct {
+	TriangleMesh* mesh;
+	const TriangleBounds* bounds;
+	int* order; // Triangle indices, partitioned in place as the hierarchy is built
+} MeshBuild;
+
+void bounds_grow(Vec3* const min, Vec3* const max, const Vec3 point_min, const Vec3 point_max) {
+	min->x = fminf(min->x, point_min.x);
+	min->y = fminf(min->y, point_min.y);
+	min->z = fminf(min->z, point_min.z);
+	max->x = fmaxf(max->x, point_max.x);
+	max->y = fmaxf(max->y, point_max.y);
+	max->z = fmaxf(max->z, point_max.z);
+}
+
+// Half the surface area of a box, 0 for an empty one
+float bounds_area(const Vec3 min, const Vec3 max) {
+	if (min.x > max.x) {
+		return 0;
+	}
+	const Vec3 size = { max.x - min.x, max.y - min.y, max.z - min.z };
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+float axis_value(const Vec3 vector, const int axis) {
+	return (&vector.x)[axis];
+}
+
+uint32_t build_mesh_node(MeshBuild* const build, const int first, const int count) {
+	TriangleMesh* const mesh = build->mesh;
+	const uint32_t index = mesh->num_nodes++;
+	int* const order = build->order + first;
+
+	Vec3 min = { FLT_MAX, FLT_MAX, FLT_MAX };
+	Vec3 max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	Vec3 centroid_min = min;
+	Vec3 centroid_max = max;
+	for (int i = 0; i < count; i++) {
+		const TriangleBounds* const bounds = &build->bounds[order[i]];
+		bounds_grow(&min, &max, bounds->min, bounds->max);
+		bounds_grow(&centroid_min, &centroid_max, bounds->centroid, bounds->centroid);
+	}
+
+	mesh->nodes[index].min = min;
+	mesh->nodes[index].max = max;
+
+	// Binned surface area heuristic over all three axes
+	int best_axis = -1;
+	int best_split = 0;
+	float best_cost = FLT_MAX;
+
+	if (count > MESH_LEAF_TRIANGLES) {
+		for (int axis = 0; axis < 3; axis++) {
+			const float axis_min = axis_value(centroid_min, axis);
+			const float extent = axis_value(centroid_max, axis) - axis_min;
+			if (extent <= 0) {
+				continue;
+			}
+
+			int bin_counts[MESH_SAH_BINS] = {};
+			Vec3 bin_mins[MESH_SAH_BINS];
+			Vec3 bin_maxs[MESH_SAH_BINS];
+			for (int bin = 0; bin < MESH_SAH_BINS; bin++) {
+				bin_mins[bin] = (Vec3){ FLT_MAX, FLT_MAX, FLT_MAX };
+				bin_maxs[bin] = (Vec3){ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			}
+
+			const float scale = MESH_SAH_BINS / extent;
+			for (int i = 0; i < count; i++) {
+				const TriangleBounds* const bounds = &build->bounds[order[i]];
+				int bin = (int)((axis_value(bounds->centroid, axis) - axis_min) * scale);
+				bin = bin < MESH_SAH_BINS ? bin : MESH_SAH_BINS - 1;
+				bin_counts[bin]++;
+				bounds_grow(&bin_mins[bin], &bin_maxs[bin], bounds->min, bounds->max);
+			}
+
+			// Sweep from the right to get the cost of everything past each split
+			float right_areas[MESH_SAH_BINS];
+			int right_counts[MESH_SAH_BINS];
+			Vec3 right_min = { FLT_MAX, FLT_MAX, FLT_MAX };
+			Vec3 right_max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			int right_count = 0;
+			for (int bin = MESH_SAH_BINS - 1; bin > 0; bin--) {
+				bounds_grow(&right_min, &right_max, bin_mins[bin], bin_maxs[bin]);
+				right_count += bin_counts[bin];
+				right_areas[bin] = bounds_area(right_min, right_max);
+				right_counts[bin] = right_count;
+			}
+
+			Vec3 left_min = { FLT_MAX, FLT_MAX, FLT_MAX };
+			Vec3 left_max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			int left_count = 0;
+			for (int split = 1; split < MESH_SAH_BINS; split++) {
+				bounds_grow(&left_min, &left_max, bin_mins[split - 1], bin_maxs[split - 1]);
+				left_count += bin_counts[split - 1];
+				if (left_count == 0 || right_counts[split] == 0) {
+					continue;
+				}
+
+				const float cost = bounds_area(left_min, left_max) * left_count + right_areas[split] * right_counts[split];
+				if (cost < best_cost) {
+					best_cost = cost;
+					best_axis = axis;
+					best_split = split;
+				}
+			}
+		}
+	}
+
+	const float parent_area = bounds_area(min, max);
+	const float split_cost = best_axis >= 0 && parent_area > 0 ? MESH_TRAVERSAL_COST + best_cost / parent_area : FLT_MAX;
+	if (count <= MESH_LEAF_TRIANGLES || (count <= MESH_LEAF_MAX_TRIANGLES && split_cost >= count)) {
+		mesh->nodes[index].triangles = (uint32_t)first << 4 | (uint32_t)count;
+		mesh->nodes[index].escape = index + 1;
+		return index;
+	}
+
+	// Without a usable split all centroids coincide and any halving is as good as another
+	int middle = count / 2;
+	if (best_axis >= 0) {
+		const float axis_min = axis_value(centroid_min, best_axis);
+		const float scale = MESH_SAH_BINS / (axis_value(centroid_max, best_axis) - axis_min);
+
+		int i = 0;
+		int j = count - 1;
+		while (i <= j) {
+			int bin = (int)((axis_value(build->bounds[order[i]].centroid, best_axis) - axis_min) * scale);
+			bin = bin < MESH_SAH_BINS ? bin : MESH_SAH_BINS - 1;
+			if (bin < best_split) {
+				i++;
+			} else {
+				const int swap = order[i];
+				order[i] = order[j];
+				order[j--] = swap;
+			}
+		}
+
+		if (i > 0 && i < count) {
+			middle = i;
+		}
+	}
+
+	mesh->nodes[index].triangles = 0;
+	build_mesh_node(build, first, middle);
+	build_mesh_node(build, first + middle, count - middle);
+	mesh->nodes[index].escape = mesh->num_nodes;
+	return index;
+}
+
+bool triangle_mesh_build(TriangleMesh* const mesh, const Vec3* const vertices, const int* const indices, const int num_triangles) {
+	*mesh = (TriangleMesh){};
+	if (num_triangles <= 0) {
+		return false;
+	}
+
+	TriangleBounds* const bounds = malloc(num_triangles * sizeof(TriangleBounds));
+	int* const order = malloc(num_triangles * sizeof(int));
+	mesh->triangles = malloc(num_triangles * sizeof(MeshTriangle));
+	mesh->nodes = malloc(2 * num_triangles * sizeof(MeshNode));
+
+	if (!bounds || !order || !mesh->triangles || !mesh->nodes) {
+		free(bounds);
+		free(order);
+		triangle_mesh_free(mesh);
+		return false;
+	}
+
+	for (int i = 0; i < num_triangles; i++) {
+		const Vec3 a = vertices[indices[3 * i]];
+		const Vec3 b = vertices[indices[3 * i + 1]];
+		const Vec3 c = vertices[indices[3 * i + 2]];
+
+		TriangleBounds* const triangle_bounds = &bounds[i];
+		triangle_bounds->min = a;
+		triangle_bounds->max = a;
+		bounds_grow(&triangle_bounds->min, &triangle_bounds->max, b, b);
+		bounds_grow(&triangle_bounds->min, &triangle_bounds->max, c, c);
+		triangle_bounds->centroid = (Vec3){ (a.x + b.x + c.x) / 3, (a.y + b.y + c.y) / 3, (a.z + b.z + c.z) / 3 };
+
+		Vec3* const half_extents = &mesh->half_extents;
+		half_extents->x = fmaxf(half_extents->x, fmaxf(fabsf(triangle_bounds->min.x), fabsf(triangle_bounds->max.x)));
+		half_extents->y = fmaxf(half_extents->y, fmaxf(fabsf(triangle_bounds->min.y), fabsf(triangle_bounds->max.y)));
+		half_extents->z = fmaxf(half_extents->z, fmaxf(fabsf(triangle_bounds->min.z), fabsf(triangle_bounds->max.z)));
+
+		order[i] = i;
+	}
+
+	MeshBuild build = { mesh, bounds, order };
+	build_mesh_node(&build, 0, num_triangles);
+
+	// Store the triangles in leaf order so the triangles of a leaf are contiguous
+	for (int i = 0; i < num_triangles; i++) {
+		const int triangle = order[i];
+		mesh->triangles[i].vertices[0] = vertices[indices[3 * triangle]];
+		mesh->triangles[i].vertices[1] = vertices[indices[3 * triangle + 1]];
+		mesh->triangles[i].vertices[2] = vertices[indices[3 * triangle + 2]];
+	}
+	mesh->num_triangles = num_triangles;
+
+	free(bounds);
+	free(order);
+	return true;
+}
+
+void triangle_mesh_free(TriangleMesh* const mesh) {
+	free(mesh->triangles);
+	free(mesh->nodes);
+	*mesh = (TriangleMesh){};
+}
+
+void triangle_mesh_query(const TriangleMesh* const mesh, const Vec3 min, const Vec3 max, const TriangleQueryCallback callback, void* const context) {
+	uint32_t index = 0;
+
+	while (index < (uint32_t)mesh->num_nodes) {
+		const MeshNode* const node = &mesh->nodes[index];
+		if (!aabbs_intersect(min, max, node->min, node->max)) {
+			index = node->escape;
+			continue;
+		}
+
+		const uint32_t count = node->triangles & 15;
+		const uint32_t first = node->triangles >> 4;
+		for (uint32_t i = 0; i < count; i++) {
+			callback(context, mesh->triangles[first + i].vertices);
+		}
+
+		// The next node is the left child of an internal node, or the node after a leaf
+		index++;
+	}
+}
+
+float triangle_mesh_cast(const TriangleMesh* const mesh, const Vec3 origin, const Vec3 direction, float max_distance, const Vec3 inflate, const TriangleCastCallback callback, void* const context) {
+	const Vec3 inverse_direction = { 1 / direction.x, 1 / direction.y, 1 / direction.z };
+	uint32_t index = 0;
+
+	while (index < (uint32_t)mesh->num_nodes) {
+		const MeshNode* const node = &mesh->nodes[index];
+		const Vec3 min = { node->min.x - inflate.x, node->min.y - inflate.y, node->min.z - inflate.z };
+		const Vec3 max = { node->max.x + inflate.x, node->max.y + inflate.y, node->max.z + inflate.z };
+
+		float entry;
+		float leave;
+		if (!ray_intersects_aabb(origin, inverse_direction, max_distance, min, max, &entry, &leave)) {
+			index = node->escape;
+			continue;
+		}
+
+		const uint32_t count = node->triangles & 15;
+		const uint32_t first = node->triangles >> 4;
+		for (uint32_t i = 0; i < count; i++) {
+			max_distance = callback(context, mesh->triangles[first + i].vertices, max_distance);
+		}
+
+		index++;
+	}
+
+	return max_distance;
+}
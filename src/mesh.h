@@ -0,0 +1,53 @@
+#pragma once
+
+#include "math_types.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Static triangle mesh collider. Triangles are stored in the leaf order of a bounding volume
+// hierarchy built with the surface area heuristic. Nodes are laid out depth first, so the left
+// child of a node is the node right after it and traversal needs no stack: a missed node
+// jumps to its escape index, past its whole subtree.
+
+enum {
+	MESH_SAH_BINS = 16
+};
+
+typedef struct {
+	Vec3 min;
+	Vec3 max;
+	uint32_t escape; // Index of the node after this subtree
+	uint32_t triangles; // First triangle << 4 | triangle count for leaves, 0 for internal nodes
+} MeshNode; // 32 bytes
+
+typedef struct {
+	Vec3 vertices[3]; // Counter clockwise seen from the front
+} MeshTriangle;
+
+typedef struct {
+	MeshTriangle* triangles;
+	int num_triangles;
+	MeshNode* nodes;
+	int num_nodes;
+	Vec3 half_extents; // Largest distance of a vertex from the body origin along each axis
+} TriangleMesh;
+
+// Called by casts for each triangle the cast may hit, with the triangle in body space. Returns
+// the distance the cast continues to, max_distance when it missed the triangle.
+typedef float (*TriangleCastCallback)(void* const context, const Vec3* const triangle, const float max_distance);
+
+// Called by queries for each triangle under the box, with the triangle in body space
+typedef void (*TriangleQueryCallback)(void* const context, const Vec3* const triangle);
+
+// Copies the indexed triangles into the mesh and builds its hierarchy. Returns false when
+// there are no triangles or the allocation failed.
+bool triangle_mesh_build(TriangleMesh* const mesh, const Vec3* const vertices, const int* const indices, const int num_triangles);
+void triangle_mesh_free(TriangleMesh* const mesh);
+
+// Runs callback on the triangles under nodes that overlap the body space box
+void triangle_mesh_query(const TriangleMesh* const mesh, const Vec3 min, const Vec3 max, const TriangleQueryCallback callback, void* const context);
+
+// Runs callback on the triangles under nodes that the body space ray origin + t * direction
+// enters before max_distance, with node bounds grown by inflate for swept shapes. Nodes past
+// the distance a callback returned are skipped. Returns the last distance.
+float triangle_mesh_cast(const TriangleMesh* const mesh, const Vec3 origin, const Vec3 direction, float max_distance, const Vec3 inflate, const TriangleCastCallback callback, void* const context);
@@ -0,0 +1,2681 @@
+#include "physics.h"
+#include "math_ops.h"
+#include "math_batch.h"
+#include "body_state.h"
+#include "broadphase.h"
+#include "command_buffer.h"
+#include "contact_events.h"
+#include "gjk.h"
+#include "math_helper.h"
+#include "profiler.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "win32_time.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <float.h>
+#include <string.h>
+
+static const Vec3 CUBE_HALF_EXTENTS = { 2.5f, 2.5f, 2.5f };
+
+static const float CUBE_MASS = 5;
+static const float COEFFICIENT_OF_RESTITUTION = 0.7f;
+static const Vec3 GRAVITY = { 0, -9.81f, 0 };
+
+static const float COLLISION_DIST_TOLERANCE = 0.01f;
+static const double COLLISION_TIME_TOLERANCE = 0.00001f;
+static const float ANGULAR_DAMPING_FACTOR = 0.999f;
+static const float TORSIONAL_FRICTION_COEFFICIENT = 0.01f;
+static const float LINEAR_FRICTION_COEFFICIENT = 0.8f;
+
+// Swept bounds are grown by this much so rotation between the start and end pose is covered
+static const float BROADPHASE_MARGIN = 0.1f;
+
+double DELTA_TIME = 1.f / 60;
+
+// Corners of a box in units of its half extents
+static const Vec3 BOX_CORNER_SIGNS[8] = {
+	{ 1, -1, -1 }, { -1, -1, -1 }, { -1, -1, 1 }, { 1, -1, 1 },
+	{ 1, 1, -1 }, { -1, 1, -1 }, { -1, 1, 1 }, { 1, 1, 1 }
+};
+
+Cube CUBES[MAX_CUBES] = {};
+
+// Static body standing in for the floor plane at y = 0 in floor contacts
+Cube GROUND = {
+	.index = -1,
+	.type = BODY_STATIC,
+	.orientation = { .m = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } } }
+};
+
+// Static bodies live in their own tree, rebuilt only after one was added or moved
+AabbTree STATIC_TREE = {};
+bool STATIC_TREE_DIRTY = true;
+AabbTree MOVING_TREE = {};
+bool MOVING_TREE_DIRTY = true; // Bodies moved since the moving tree was built
+bool ACTIVE_CUBES[MAX_CUBES] = {};
+bool RESTING_CUBES[MAX_CUBES] = {};
+
+// Last GJK simplex of each pair of bodies, warm starts the next query on the same pair.
+// Direct mapped, a pair landing on an occupied slot evicts the previous one.
+enum { SIMPLEX_CACHE_SIZE = 1024 };
+
+typedef struct {
+	int index_a;
+	int index_b;
+	GjkSimplex simplex;
+} SimplexCacheEntry;
+
+SimplexCacheEntry SIMPLEX_CACHE[SIMPLEX_CACHE_SIZE] = {};
+
+enum { MAX_CONTACTS = 256 };
+Contact CONTACTS[MAX_CONTACTS] = {};
+bool ACTIVE_CONTACTS[MAX_CONTACTS] = {};
+
+Vec3 COLLISION_POINT_BUFFER[COLLISION_POINT_BUFFER_SIZE] = {};
+unsigned int NEXT_COLLISION_POINT_BUFFER_INDEX = 0;
+
+Vec3 COLLISION_NORMAL_BUFFER[COLLISION_NORMAL_BUFFER_SIZE][2] = {};
+Vec3 COLLISION_EDGES_BUFFER[COLLISION_NORMAL_BUFFER_SIZE][4] = {};
+unsigned int NEXT_COLLISION_NORMAL_BUFFER_INDEX = 0;
+unsigned int NEXT_COLLISION_EDGES_BUFFER_INDNEX = 0;
+
+void buffer_collision_point(const Vec3 point) {
+	COLLISION_POINT_BUFFER[NEXT_COLLISION_POINT_BUFFER_INDEX] = point;
+	NEXT_COLLISION_POINT_BUFFER_INDEX = (NEXT_COLLISION_POINT_BUFFER_INDEX + 1) % COLLISION_POINT_BUFFER_SIZE;
+}
+
+void buffer_collision_normal(const Vec3 position, const Vec3 direction) {
+	COLLISION_NORMAL_BUFFER[NEXT_COLLISION_NORMAL_BUFFER_INDEX][0] = position;
+	COLLISION_NORMAL_BUFFER[NEXT_COLLISION_NORMAL_BUFFER_INDEX][1] = direction;
+	NEXT_COLLISION_NORMAL_BUFFER_INDEX = (NEXT_COLLISION_NORMAL_BUFFER_INDEX + 1) % COLLISION_NORMAL_BUFFER_SIZE;
+}
+
+void buffer_collision_edges(const Vec3 edge_a_start, const Vec3 edge_a_dir, const Vec3 edge_b_start, const Vec3 edge_b_dir)  {
+	COLLISION_EDGES_BUFFER[NEXT_COLLISION_NORMAL_BUFFER_INDEX][0] = edge_a_start;
+	COLLISION_EDGES_BUFFER[NEXT_COLLISION_NORMAL_BUFFER_INDEX][1] = edge_a_dir;
+	COLLISION_EDGES_BUFFER[NEXT_COLLISION_NORMAL_BUFFER_INDEX][2] = edge_b_start;
+	COLLISION_EDGES_BUFFER[NEXT_COLLISION_NORMAL_BUFFER_INDEX][3] = edge_b_dir;
+	NEXT_COLLISION_EDGES_BUFFER_INDNEX = (NEXT_COLLISION_EDGES_BUFFER_INDNEX + 1) % COLLISION_NORMAL_BUFFER_SIZE;
+}
+
+PointsSoA geometry_corners(const BoxGeometry* const geometry) {
+	return (PointsSoA){ (float*)geometry->corners_x, (float*)geometry->corners_y, (float*)geometry->corners_z };
+}
+
+Vec3 box_local_corner(const Cube* const cube, const int corner_index) {
+	return vec3_mul(BOX_CORNER_SIGNS[corner_index], cube->half_extents);
+}
+
+// Builds world space corners, face normals and AABB straight from a pose
+void box_geometry_from_pose(BoxGeometry* const geometry, const Pose* const pose, const Vec3 half_extents) {
+	const PointsSoA corners = geometry_corners(geometry);
+
+	// Orientation with its columns scaled by the half extents
+	Mat3 linear = pose->orientation;
+	for (int i = 0; i < 3; i++) {
+		linear.m[i][0] *= half_extents.x;
+		linear.m[i][1] *= half_extents.y;
+		linear.m[i][2] *= half_extents.z;
+	}
+	points_transform_affine(corners, BOX_CORNER_SIGNS, 8, &linear, pose->position);
+
+	geometry->face_normals[0] = vec3_normalize(vec3_mul_mat3(new_vec3(1, 0, 0), &pose->orientation));
+	geometry->face_normals[1] = vec3_normalize(vec3_mul_mat3(new_vec3(0, 1, 0), &pose->orientation));
+	geometry->face_normals[2] = vec3_normalize(vec3_mul_mat3(new_vec3(0, 0, 1), &pose->orientation));
+
+	Vec3 aabb_min = { FLT_MAX, FLT_MAX, FLT_MAX };
+	Vec3 aabb_max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (int i = 0; i < 8; i++) {
+		aabb_min.x = fminf(aabb_min.x, corners.x[i]);
+		aabb_min.y = fminf(aabb_min.y, corners.y[i]);
+		aabb_min.z = fminf(aabb_min.z, corners.z[i]);
+		aabb_max.x = fmaxf(aabb_max.x, corners.x[i]);
+		aabb_max.y = fmaxf(aabb_max.y, corners.y[i]);
+		aabb_max.z = fmaxf(aabb_max.z, corners.z[i]);
+	}
+	geometry->aabb_min = aabb_min;
+	geometry->aabb_max = aabb_max;
+}
+
+bool aabbs_overlap(const BoxGeometry* const a, const BoxGeometry* const b) {
+	return a->aabb_min.x < b->aabb_max.x && b->aabb_min.x < a->aabb_max.x &&
+		a->aabb_min.y < b->aabb_max.y && b->aabb_min.y < a->aabb_max.y &&
+		a->aabb_min.z < b->aabb_max.z && b->aabb_min.z < a->aabb_max.z;
+}
+
+// Body space point from a world space point
+Vec3 pose_world_to_local(const Pose* const pose, const Vec3 world_point) {
+	const Mat3 inverse_orientation = mat3_inverse(&pose->orientation);
+	return vec3_mul_mat3(vec3_sub(world_point, pose->position), &inverse_orientation);
+}
+
+Vec3 pose_to_world(const Pose* const pose, const Vec3 local_point) {
+	return vec3_add(vec3_mul_mat3(local_point, &pose->orientation), pose->position);
+}
+
+// Rotates a world space direction by the inverse of an orientation, which is a rotation so its transpose is its inverse
+Vec3 rotate_to_local(const Mat3* const orientation, const Vec3 direction) {
+	const float (*const m)[3] = orientation->m;
+	return (Vec3){
+		m[0][0] * direction.x + m[1][0] * direction.y + m[2][0] * direction.z,
+		m[0][1] * direction.x + m[1][1] * direction.y + m[2][1] * direction.z,
+		m[0][2] * direction.x + m[1][2] * direction.y + m[2][2] * direction.z
+	};
+}
+
+// Rotates a world space direction into the body space of a cube
+Vec3 world_to_body(const Cube* const cube, const Vec3 direction) {
+	return rotate_to_local(&cube->orientation, direction);
+}
+
+Vec3 body_to_world(const Cube* const cube, const Vec3 direction) {
+	return vec3_mul_mat3(direction, &cube->orientation);
+}
+
+Pose cube_pose(const Cube* const cube) {
+	return (Pose){ cube->position, cube->orientation };
+}
+
+// Call after changing position or orientation, the matrices and geometry are rebuilt on next read
+void invalidate_transform(Cube* const cube) {
+	cube->transform_dirty = true;
+	cube->geometry_dirty = true;
+
+	// Stand-in bodies of compound children have no slot in the trees
+	if (cube->index >= 0) {
+		MOVING_TREE_DIRTY = true;
+		cube->state_stamp = BODY_STATE_CLOCK;
+	}
+}
+
+void update_transform(Cube* const cube) {
+	// Compute transformation matrix
+	Mat4 transform = MAT4_IDENTITY;
+	transform = mat4_translate(&transform, cube->position);
+	const Mat4 orientation = mat3_to_mat4(&cube->orientation);
+	// The render mesh is a unit cube
+	const Mat3 scale_mat3 = mat3_scale(&MAT3_IDENTITY, vec3_scale(cube->half_extents, 2));
+	const Mat4 scale = mat3_to_mat4(&scale_mat3);
+	mat4_mul_into(&transform, &transform, &orientation);
+	mat4_mul_into(&transform, &transform, &scale);
+	cube->transform = transform;
+
+	// Compute inverse transformation matrix
+	const Mat3 inverse_orientation = mat3_inverse(&cube->orientation);
+	const Mat3 inverse_scale = mat3_inverse(&scale_mat3);
+	const Vec3 inverse_translation = vec3_scale(vec3_mul_mat3(vec3_mul_mat3(cube->position, &inverse_scale), &inverse_orientation), -1);
+
+	Mat3 inverse_transform_mat3 = MAT3_IDENTITY;
+	inverse_transform_mat3 = mat3_mul(&inverse_transform_mat3, &inverse_orientation);
+	inverse_transform_mat3 = mat3_mul(&inverse_transform_mat3, &inverse_scale);
+	Mat4 inverse_transform = mat3_to_mat4(&inverse_transform_mat3);
+	inverse_transform = mat4_translate(&inverse_transform, inverse_translation);
+	cube->inverse_transform = inverse_transform;
+
+	cube->transform_dirty = false;
+}
+
+const Mat4* cube_transform(Cube* const cube) {
+	if (cube->transform_dirty) {
+		update_transform(cube);
+	}
+	return &cube->transform;
+}
+
+const Mat4* cube_inverse_transform(Cube* const cube) {
+	if (cube->transform_dirty) {
+		update_transform(cube);
+	}
+	return &cube->inverse_transform;
+}
+
+const BoxGeometry* cube_geometry(Cube* const cube) {
+	if (cube->geometry_dirty) {
+		const Pose pose = cube_pose(cube);
+		box_geometry_from_pose(&cube->geometry, &pose, cube->half_extents);
+		cube->geometry_dirty = false;
+	}
+	return &cube->geometry;
+}
+
+GjkSimplex* simplex_cache_find(const int index_a, const int index_b) {
+	const unsigned int hash = (unsigned int)index_a * 73856093u ^ (unsigned int)index_b * 19349663u;
+	SimplexCacheEntry* const entry = &SIMPLEX_CACHE[hash % SIMPLEX_CACHE_SIZE];
+	if (entry->index_a != index_a || entry->index_b != index_b) {
+		entry->index_a = index_a;
+		entry->index_b = index_b;
+		entry->simplex.count = 0;
+	}
+	return &entry->simplex;
+}
+
+// A reused body slot must not warm start from the shape that was there before
+void simplex_cache_forget(const int index) {
+	for (int i = 0; i < SIMPLEX_CACHE_SIZE; i++) {
+		if (SIMPLEX_CACHE[i].index_a == index || SIMPLEX_CACHE[i].index_b == index) {
+			SIMPLEX_CACHE[i].simplex.count = 0;
+		}
+	}
+}
+
+void physics_reset() {
+	memset(CUBES, 0, sizeof(CUBES));
+	memset(SIMPLEX_CACHE, 0, sizeof(SIMPLEX_CACHE));
+	memset(ACTIVE_CUBES, 0, sizeof(ACTIVE_CUBES));
+	memset(RESTING_CUBES, 0, sizeof(RESTING_CUBES));
+	memset(ACTIVE_CONTACTS, 0, sizeof(ACTIVE_CONTACTS));
+	contact_events_reset();
+	STATIC_TREE_DIRTY = true;
+	MOVING_TREE_DIRTY = true;
+}
+
+// The trees are left out, update_broadphase rebuilds them from the bodies
+int physics_state_sections(StateSection* const sections) {
+	sections[0] = (StateSection){ CUBES, sizeof(CUBES) };
+	sections[1] = (StateSection){ ACTIVE_CUBES, sizeof(ACTIVE_CUBES) };
+	sections[2] = (StateSection){ RESTING_CUBES, sizeof(RESTING_CUBES) };
+	sections[3] = (StateSection){ CONTACTS, sizeof(CONTACTS) };
+	sections[4] = (StateSection){ ACTIVE_CONTACTS, sizeof(ACTIVE_CONTACTS) };
+	sections[5] = (StateSection){ SIMPLEX_CACHE, sizeof(SIMPLEX_CACHE) };
+	return 6;
+}
+
+// Returns NULL if there are no free cube slots
+Cube* add_cube(const Vec3 position, const Mat3 orientation) {
+	return add_box(position, orientation, CUBE_HALF_EXTENTS, CUBE_MASS);
+}
+
+// Claims a free cube slot for a body of the given shape and body space bounds. A mass of 0
+// makes it static, otherwise inertia is the diagonal of its inertia tensor in body space.
+// Returns NULL if there are no free cube slots.
+Cube* add_body(const ShapeType shape, const Vec3 position, const Mat3 orientation, const Vec3 half_extents, const float mass, const Vec3 inertia) {
+	for (int i = 0; i < MAX_CUBES; i++) {
+		if (ACTIVE_CUBES[i]) {
+			continue;
+		}
+
+		Cube* const cube = &CUBES[i];
+		*cube = (Cube){};
+		cube->index = i;
+		cube->shape = shape;
+		cube->position = position;
+		cube->orientation = orientation;
+		cube->half_extents = half_extents;
+		cube->mass = mass;
+		cube->type = mass > 0 ? BODY_DYNAMIC : BODY_STATIC;
+
+		if (cube->type == BODY_STATIC) {
+			STATIC_TREE_DIRTY = true;
+		} else {
+			cube->inverse_mass = 1 / mass;
+			cube->inverse_inertia = new_vec3(1 / inertia.x, 1 / inertia.y, 1 / inertia.z);
+		}
+
+		invalidate_transform(cube);
+		simplex_cache_forget(i);
+
+		ACTIVE_CUBES[i] = true;
+		RESTING_CUBES[i] = false;
+
+		return cube;
+	}
+
+	return NULL;
+}
+
+// Solid box: I = m / 3 * (b^2 + c^2) in terms of the half extents
+Vec3 box_inertia(const Vec3 half_extents, const float mass) {
+	const Vec3 squared = vec3_mul(half_extents, half_extents);
+	return vec3_scale(new_vec3(squared.y + squared.z, squared.x + squared.z, squared.x + squared.y), mass / 3);
+}
+
+Vec3 sphere_inertia(const float radius, const float mass) {
+	const float moment = 0.4f * mass * radius * radius;
+	return new_vec3(moment, moment, moment);
+}
+
+// Splits the mass between the cylinder and the two hemispheres by volume
+Vec3 capsule_inertia(const float radius, const float half_height, const float mass) {
+	const float height = 2 * half_height;
+	const float cylinder_volume = PI * radius * radius * height;
+	const float sphere_volume = 4.f / 3 * PI * radius * radius * radius;
+	const float cylinder_mass = mass * cylinder_volume / (cylinder_volume + sphere_volume);
+	const float sphere_mass = mass - cylinder_mass;
+
+	const float r2 = radius * radius;
+	const float axial = cylinder_mass * r2 / 2 + sphere_mass * r2 * 2 / 5;
+	const float transverse = cylinder_mass * (height * height / 12 + r2 / 4) +
+		sphere_mass * (r2 * 2 / 5 + height * height / 4 + 3 * height * radius / 8);
+	return new_vec3(transverse, axial, transverse);
+}
+
+// Solid dynamic box with the given half extents, a mass of 0 adds a static box instead.
+// Returns NULL if there are no free cube slots.
+Cube* add_box(const Vec3 position, const Mat3 orientation, const Vec3 half_extents, const float mass) {
+	return add_body(SHAPE_BOX, position, orientation, half_extents, mass, box_inertia(half_extents, mass));
+}
+
+Cube* add_static_box(const Vec3 position, const Mat3 orientation, const Vec3 half_extents) {
+	return add_box(position, orientation, half_extents, 0);
+}
+
+// The caller drives a kinematic box through its velocity and angular velocity
+Cube* add_kinematic_box(const Vec3 position, const Mat3 orientation, const Vec3 half_extents) {
+	Cube* const cube = add_box(position, orientation, half_extents, 0);
+	if (cube) {
+		cube->type = BODY_KINEMATIC;
+	}
+	return cube;
+}
+
+// Solid sphere, a mass of 0 adds a static sphere
+Cube* add_sphere(const Vec3 position, const float radius, const float mass) {
+	Cube* const cube = add_body(SHAPE_SPHERE, position, MAT3_IDENTITY, new_vec3(radius, radius, radius), mass, sphere_inertia(radius, mass));
+	if (cube) {
+		cube->radius = radius;
+	}
+	return cube;
+}
+
+// Solid capsule whose segment runs from -half_height to half_height along the body y axis,
+// a mass of 0 adds a static capsule
+Cube* add_capsule(const Vec3 position, const Mat3 orientation, const float radius, const float half_height, const float mass) {
+	Cube* const cube = add_body(SHAPE_CAPSULE, position, orientation, new_vec3(radius, half_height + radius, radius), mass, capsule_inertia(radius, half_height, mass));
+	if (cube) {
+		cube->radius = radius;
+		cube->half_height = half_height;
+	}
+	return cube;
+}
+
+// Convex hull body, inertia is approximated by the hull's bounding box. A mass of 0 adds a static hull.
+Cube* add_hull(const Vec3 position, const Mat3 orientation, const ConvexHull* const hull, const float mass) {
+	Cube* const cube = add_body(SHAPE_HULL, position, orientation, hull->half_extents, mass, box_inertia(hull->half_extents, mass));
+	if (cube) {
+		cube->hull = hull;
+	}
+	return cube;
+}
+
+// Meshes are always static
+Cube* add_mesh(const Vec3 position, const Mat3 orientation, const TriangleMesh* const mesh) {
+	Cube* const cube = add_body(SHAPE_MESH, position, orientation, mesh->half_extents, 0, (Vec3){});
+	if (cube) {
+		cube->mesh = mesh;
+	}
+	return cube;
+}
+
+// Heightfields are always static
+Cube* add_heightfield(const Vec3 position, const Mat3 orientation, const Heightfield* const heightfield) {
+	Cube* const cube = add_body(SHAPE_HEIGHTFIELD, position, orientation, heightfield->half_extents, 0, (Vec3){});
+	if (cube) {
+		cube->heightfield = heightfield;
+	}
+	return cube;
+}
+
+// Body space bounds of a child shape, rotated by the child's pose into the compound's body space
+void compound_child_bounds(const CompoundChild* const child, Vec3* const min, Vec3* const max) {
+	const float (*const m)[3] = child->pose.orientation.m;
+	const Vec3 half_extents = child->half_extents;
+	const Vec3 extent = {
+		fabsf(m[0][0]) * half_extents.x + fabsf(m[0][1]) * half_extents.y + fabsf(m[0][2]) * half_extents.z,
+		fabsf(m[1][0]) * half_extents.x + fabsf(m[1][1]) * half_extents.y + fabsf(m[1][2]) * half_extents.z,
+		fabsf(m[2][0]) * half_extents.x + fabsf(m[2][1]) * half_extents.y + fabsf(m[2][2]) * half_extents.z
+	};
+	*min = vec3_sub(child->pose.position, extent);
+	*max = vec3_add(child->pose.position, extent);
+}
+
+// Copies the children, moves them onto their common center of mass and builds the mass
+// properties and the child tree. Returns false for an empty or too large compound or a
+// child that is not convex.
+bool compound_shape_build(CompoundShape* const compound, const CompoundChild* const children, const int num_children) {
+	if (num_children <= 0 || num_children > COMPOUND_MAX_CHILDREN) {
+		return false;
+	}
+
+	compound->num_children = num_children;
+	compound->mass = 0;
+	Vec3 weighted_positions = {};
+
+	for (int i = 0; i < num_children; i++) {
+		CompoundChild* const child = &compound->children[i];
+		*child = children[i];
+
+		switch (child->shape) {
+			case SHAPE_BOX: break;
+			case SHAPE_SPHERE: child->half_extents = new_vec3(child->radius, child->radius, child->radius); break;
+			case SHAPE_CAPSULE: child->half_extents = new_vec3(child->radius, child->half_height + child->radius, child->radius); break;
+			case SHAPE_HULL: child->half_extents = child->hull->half_extents; break;
+			default: return false;
+		}
+
+		compound->mass += child->mass;
+		weighted_positions = vec3_add(weighted_positions, vec3_scale(child->pose.position, child->mass));
+	}
+
+	compound->center_of_mass = compound->mass > 0 ? vec3_scale(weighted_positions, 1 / compound->mass) : (Vec3){};
+
+	compound->inertia = (Vec3){};
+	compound->half_extents = (Vec3){};
+	AabbProxy proxies[COMPOUND_MAX_CHILDREN];
+
+	for (int i = 0; i < num_children; i++) {
+		CompoundChild* const child = &compound->children[i];
+		child->pose.position = vec3_sub(child->pose.position, compound->center_of_mass);
+
+		Vec3 inertia;
+		switch (child->shape) {
+			case SHAPE_SPHERE: inertia = sphere_inertia(child->radius, child->mass); break;
+			case SHAPE_CAPSULE: inertia = capsule_inertia(child->radius, child->half_height, child->mass); break;
+			default: inertia = box_inertia(child->half_extents, child->mass); break;
+		}
+
+		// Diagonal of the child's tensor rotated into the compound, plus the parallel axis term
+		const float (*const m)[3] = child->pose.orientation.m;
+		const Vec3 offset = child->pose.position;
+		const Vec3 squared = vec3_mul(offset, offset);
+		compound->inertia.x += m[0][0] * m[0][0] * inertia.x + m[0][1] * m[0][1] * inertia.y + m[0][2] * m[0][2] * inertia.z + child->mass * (squared.y + squared.z);
+		compound->inertia.y += m[1][0] * m[1][0] * inertia.x + m[1][1] * m[1][1] * inertia.y + m[1][2] * m[1][2] * inertia.z + child->mass * (squared.x + squared.z);
+		compound->inertia.z += m[2][0] * m[2][0] * inertia.x + m[2][1] * m[2][1] * inertia.y + m[2][2] * m[2][2] * inertia.z + child->mass * (squared.x + squared.y);
+
+		proxies[i].index = i;
+		compound_child_bounds(child, &proxies[i].min, &proxies[i].max);
+
+		Vec3* const half_extents = &compound->half_extents;
+		half_extents->x = fmaxf(half_extents->x, fmaxf(-proxies[i].min.x, proxies[i].max.x));
+		half_extents->y = fmaxf(half_extents->y, fmaxf(-proxies[i].min.y, proxies[i].max.y));
+		half_extents->z = fmaxf(half_extents->z, fmaxf(-proxies[i].min.z, proxies[i].max.z));
+	}
+
+	aabb_tree_build(&compound->tree, proxies, num_children);
+	return true;
+}
+
+// Compound body whose origin is at position, which is its center of mass. A compound
+// without mass is static.
+Cube* add_compound(const Vec3 position, const Mat3 orientation, const CompoundShape* const compound) {
+	Cube* const cube = add_body(SHAPE_COMPOUND, position, orientation, compound->half_extents, compound->mass, compound->inertia);
+	if (cube) {
+		cube->compound = compound;
+	}
+	return cube;
+}
+
+// Teleports a static body, which marks the static tree for a rebuild
+void set_static_pose(Cube* const cube, const Vec3 position, const Mat3 orientation) {
+	cube->position = position;
+	cube->orientation = orientation;
+	invalidate_transform(cube);
+	STATIC_TREE_DIRTY = true;
+}
+
+// Frees the body's slot, the next add may reuse it. Its touching pairs end in the next step.
+void remove_body(Cube* const cube) {
+	const int index = cube->index;
+	if (index < 0 || !ACTIVE_CUBES[index]) {
+		return;
+	}
+
+	ACTIVE_CUBES[index] = false;
+	RESTING_CUBES[index] = false;
+	if (cube->type == BODY_STATIC) {
+		STATIC_TREE_DIRTY = true;
+	}
+	MOVING_TREE_DIRTY = true;
+	contact_events_forget(index);
+}
+
+// Kinetic plus gravitational potential energy of all active cubes, with the floor as zero height
+float physics_total_energy() {
+	float energy = 0;
+
+	for (int i = 0; i < MAX_CUBES; i++) {
+		if (!ACTIVE_CUBES[i]) {
+			continue;
+		}
+
+		const Cube* const cube = &CUBES[i];
+		if (cube->type != BODY_DYNAMIC) {
+			continue;
+		}
+
+		const Vec3 angular_velocity = cube->angular_velocity;
+		const Vec3 inverse_inertia = cube->inverse_inertia;
+
+		energy += 0.5f * cube->mass * vec3_dot(cube->velocity, cube->velocity);
+		energy += 0.5f * (
+			angular_velocity.x * angular_velocity.x / inverse_inertia.x +
+			angular_velocity.y * angular_velocity.y / inverse_inertia.y +
+			angular_velocity.z * angular_velocity.z / inverse_inertia.z);
+		energy -= cube->mass * vec3_dot(GRAVITY, cube->position);
+	}
+
+	return energy;
+}
+
+bool cube_is_resting(const int index) {
+	/*
+	for (int i = 0; i < MAX_CONTACTS; i++) {
+		if (!ACTIVE_CONTACTS[i]) {
+			continue;
+		}
+
+		if (CONTACTS[i].cube->index == index) {
+			return true;
+		}
+
+	}
+	*/
+
+	if (RESTING_CUBES[index]) {
+		return true;
+	}
+
+	return false;
+}
+
+void add_contact(Cube* const cube, const Vec3 contact_point, const Vec3 contact_normal, const float penetration_depth) {
+	if (cube_is_resting(cube->index)) {
+		return;
+	}
+
+	for (int i = 0; i < MAX_CONTACTS; i++) {
+		if (ACTIVE_CONTACTS[i]) {
+			continue;
+		}
+
+		Contact new_contact;
+		new_contact.cube = cube;
+		new_contact.point = contact_point;
+		new_contact.normal = contact_normal;
+		new_contact.penetration_depth = penetration_depth;
+
+		CONTACTS[i] = new_contact;
+		ACTIVE_CONTACTS[i] = true;
+
+		return;
+	}
+
+	SIM_STATS.contact_pool_overflows++;
+}
+
+void remove_contact(const int contact_index) {
+	ACTIVE_CONTACTS[contact_index] = false;
+}
+
+// Damping and gravity only apply to dynamic bodies, kinematic bodies keep their scripted velocities
+Vec3 damped_angular_velocity(const Cube* const cube, const float t) {
+	if (cube->type != BODY_DYNAMIC) {
+		return cube->angular_velocity;
+	}
+	return vec3_scale(cube->angular_velocity, 1 - ANGULAR_DAMPING_FACTOR * t);
+}
+
+Vec3 accelerated_velocity(const Cube* const cube, const float t) {
+	if (cube->type != BODY_DYNAMIC) {
+		return cube->velocity;
+	}
+	return vec3_add(cube->velocity, vec3_scale(GRAVITY, t));
+}
+
+// Extrapolates the pose of a cube t into the step from its velocity, angular velocity and
+// gravity without touching the cube. Gives exactly the pose integrate_cube would produce.
+Pose cube_pose_at(const Cube* const cube, const float t) {
+	if (cube->type == BODY_STATIC) {
+		return cube_pose(cube);
+	}
+
+	const Vec3 velocity = accelerated_velocity(cube, t);
+	const Vec3 angular_velocity = damped_angular_velocity(cube, t);
+
+	Pose pose;
+	pose.position = vec3_add(cube->position, vec3_scale(velocity, t));
+
+	const Vec3 axis = vec3_normalize(angular_velocity);
+	const float angle = vec3_length(angular_velocity);
+	pose.orientation = mat3_rotate(&cube->orientation, deg(angle) * t, axis);
+
+	return pose;
+}
+
+// Integrates a cube by t
+void integrate_cube(Cube* const cube, const float t) {
+	if (cube->type == BODY_STATIC) {
+		return;
+	}
+
+	const Pose pose = cube_pose_at(cube, t);
+
+	cube->angular_velocity = damped_angular_velocity(cube, t);
+	cube->velocity = accelerated_velocity(cube, t);
+	cube->position = pose.position;
+	cube->orientation = pose.orientation;
+
+	invalidate_transform(cube);
+}
+
+Pose probe_pose(const Cube* const cube, const float t) {
+	return t == 0 ? cube_pose(cube) : cube_pose_at(cube, t);
+}
+
+// Pose and world geometry of a cube t into the step. At t = 0 this is the cube's cached
+// geometry, otherwise it is built into storage from the extrapolated pose.
+const BoxGeometry* probe_geometry(Cube* const cube, const float t, Pose* const pose, BoxGeometry* const storage) {
+	*pose = probe_pose(cube, t);
+	if (t == 0) {
+		return cube_geometry(cube);
+	}
+
+	box_geometry_from_pose(storage, pose, cube->half_extents);
+	return storage;
+}
+
+// World space end points of a capsule's segment, a sphere is a capsule with both at its center
+void shape_segment(const Cube* const cube, const Pose* const pose, Vec3* const start, Vec3* const end) {
+	const Vec3 half_axis = vec3_mul_mat3(new_vec3(0, cube->half_height, 0), &pose->orientation);
+	*start = vec3_sub(pose->position, half_axis);
+	*end = vec3_add(pose->position, half_axis);
+}
+
+// Appends a contact at a world space point to a manifold between cube_a and cube_b,
+// normal points from b towards a and a negative depth means penetration
+void manifold_add_point(ContactManifold* const contact_manifold, Cube* const cube_a, Cube* const cube_b, const Pose* const pose_a, const Pose* const pose_b, const Vec3 point, const Vec3 normal, const float depth) {
+	if (contact_manifold->num_points >= MANIFOLD_POINTS) {
+		SIM_STATS.manifold_overflows++;
+		return;
+	}
+
+	const int index = contact_manifold->num_points++;
+	contact_manifold->local_points_a[index] = rotate_to_local(&pose_a->orientation, vec3_sub(point, pose_a->position));
+	contact_manifold->local_points_b[index] = rotate_to_local(&pose_b->orientation, vec3_sub(point, pose_b->position));
+	contact_manifold->depths[index] = depth;
+	contact_manifold->normal = normal;
+	contact_manifold->cube_a = cube_a;
+	contact_manifold->cube_b = cube_b;
+}
+
+// Spheres and capsules touch the floor with the lowest point of the sphere around each segment end
+bool collision_check_floor_round(ContactManifold* const contact_manifold, Cube* const cube, const float t) {
+	const Pose pose = probe_pose(cube, t);
+	const Pose ground_pose = cube_pose(&GROUND);
+
+	Vec3 ends[2];
+	shape_segment(cube, &pose, &ends[0], &ends[1]);
+	const int num_ends = cube->shape == SHAPE_SPHERE ? 1 : 2;
+
+	bool collision = false;
+	for (int i = 0; i < num_ends; i++) {
+		const float depth = ends[i].y - cube->radius;
+		if (depth >= COLLISION_DIST_TOLERANCE) {
+			continue;
+		}
+
+		collision = true;
+		if (contact_manifold) {
+			manifold_add_point(contact_manifold, cube, &GROUND, &pose, &ground_pose, new_vec3(ends[i].x, depth, ends[i].z), new_vec3(0, 1, 0), depth);
+		}
+	}
+
+	return collision;
+}
+
+bool collision_check_floor_hull(ContactManifold* const contact_manifold, Cube* const cube, const float t) {
+	const Pose pose = probe_pose(cube, t);
+	const Pose ground_pose = cube_pose(&GROUND);
+	const ConvexHull* const hull = cube->hull;
+
+	bool collision = false;
+	for (int i = 0; i < hull->num_vertices; i++) {
+		const Vec3 vertex = pose_to_world(&pose, hull->vertices[i]);
+		if (vertex.y >= COLLISION_DIST_TOLERANCE) {
+			continue;
+		}
+
+		collision = true;
+		if (contact_manifold) {
+			manifold_add_point(contact_manifold, cube, &GROUND, &pose, &ground_pose, vertex, new_vec3(0, 1, 0), vertex.y);
+		}
+	}
+
+	return collision;
+}
+
+// Checks for collisions and contacts.
+// t = 0 is start of frame,
+// t = DELTA_TIME is end of frame
+bool collision_check_floor_shape(ContactManifold* const contact_manifold, Cube* const cube, const float t) {
+	if (cube->shape == SHAPE_HULL) {
+		return collision_check_floor_hull(contact_manifold, cube, t);
+	}
+	if (cube->shape != SHAPE_BOX) {
+		return collision_check_floor_round(contact_manifold, cube, t);
+	}
+
+	Pose pose;
+	BoxGeometry geometry_storage;
+	const BoxGeometry* const geometry = probe_geometry(cube, t, &pose, &geometry_storage);
+
+	if (geometry->aabb_min.y >= COLLISION_DIST_TOLERANCE) {
+		return false;
+	}
+
+	bool no_collisions = true;
+	const PointsSoA corners = geometry_corners(geometry);
+
+	// Check all corners against the floor
+	for (int i = 0; i < 8; i++) {
+		if (corners.y[i] < COLLISION_DIST_TOLERANCE) {
+			no_collisions = false;
+
+			if (contact_manifold) {
+				if (contact_manifold->num_points >= MANIFOLD_POINTS) {
+					SIM_STATS.manifold_overflows++;
+					continue;
+				}
+
+				// The ground has the identity pose, so its body space is world space
+				contact_manifold->local_points_a[contact_manifold->num_points] = box_local_corner(cube, i);
+				contact_manifold->local_points_b[contact_manifold->num_points] = points_get(corners, i);
+				contact_manifold->depths[contact_manifold->num_points] = corners.y[i];
+				contact_manifold->normal = new_vec3(0, 1, 0);
+				contact_manifold->num_points++;
+				contact_manifold->cube_a = cube;
+				contact_manifold->cube_b = &GROUND;
+			}
+		}
+
+	}
+
+	return !no_collisions;
+}
+
+Vec3 lerp_line_segment(const Vec3 start, const Vec3 end, const float t) {
+	return vec3_add(start, vec3_scale(end, t));
+}
+
+// Closest point to point on the segment from start to end
+Vec3 closest_point_line_segment(const Vec3 start, const Vec3 end, const Vec3 point) {
+	const Vec3 direction = vec3_sub(end, start);
+	const float length_squared = vec3_dot(direction, direction);
+	if (length_squared == 0) {
+		return start;
+	}
+
+	const float t = fminf(fmaxf(vec3_dot(vec3_sub(point, start), direction) / length_squared, 0), 1);
+	return vec3_add(start, vec3_scale(direction, t));
+}
+
+// Projects segment b onto segment a and returns the overlap as parameters along a, low > high
+// when b lies past either end of a. Only meaningful for parallel segments.
+void segment_overlap(const Vec3 a_start, const Vec3 a_end, const Vec3 b_start, const Vec3 b_end, float* const low, float* const high) {
+	const Vec3 a_dir = vec3_sub(a_end, a_start);
+	const float length_squared = vec3_dot(a_dir, a_dir);
+	if (length_squared == 0) {
+		*low = 0;
+		*high = 0;
+		return;
+	}
+
+	const float t_start = vec3_dot(vec3_sub(b_start, a_start), a_dir) / length_squared;
+	const float t_end = vec3_dot(vec3_sub(b_end, a_start), a_dir) / length_squared;
+	*low = fmaxf(fminf(t_start, t_end), 0);
+	*high = fminf(fmaxf(t_start, t_end), 1);
+}
+
+bool segments_parallel(const Vec3 a_dir, const Vec3 b_dir) {
+	const float a_dot_b = vec3_dot(a_dir, b_dir);
+	const float determinant = vec3_dot(a_dir, a_dir) * vec3_dot(b_dir, b_dir) - a_dot_b * a_dot_b;
+	return fabsf(determinant) <= 1e-6f * vec3_dot(a_dir, a_dir) * vec3_dot(b_dir, b_dir);
+}
+
+// Returns minimum distance between lines
+float closest_points_line_segments(const Vec3 a_start, const Vec3 a_end, const Vec3 b_start, const Vec3 b_end, Vec3* const point_a, Vec3* const point_b) {
+	const Vec3 a_dir = vec3_sub(a_end, a_start);
+	const Vec3 b_dir = vec3_sub(b_end, b_start);
+
+	// Variables for system of equations
+	// ax + by = e
+	// cx + dy = f
+	const float a = vec3_dot(b_dir, a_dir);
+	const float b = -vec3_dot(a_dir, a_dir);
+	const float c = vec3_dot(b_dir, b_dir);
+	const float d = -vec3_dot(a_dir, b_dir);
+	const float e = -vec3_dot(b_start, a_dir) + vec3_dot(a_start, a_dir);
+	const float f = -vec3_dot(b_start, b_dir) + vec3_dot(a_start, b_dir);
+
+	// Parallel lines (or a segment of zero length) have no unique solution. Take the middle of
+	// the part where b overlaps a, or the end of a nearest to b if they do not overlap.
+	const float determinant = a * d - b * c;
+	if (fabsf(determinant) <= 1e-6f * c * -b) {
+		float low, high;
+		segment_overlap(a_start, a_end, b_start, b_end, &low, &high);
+		const float t = low <= high ? (low + high) / 2 : (low > 1 ? 1 : 0);
+		*point_a = vec3_add(a_start, vec3_scale(a_dir, t));
+		*point_b = closest_point_line_segment(b_start, b_end, *point_a);
+		return vec3_length(vec3_sub(*point_b, *point_a));
+	}
+
+	// Solve system of equations
+	float s = (e * d - b * f) / determinant;
+	float t = (a * f - e * c) / determinant;
+
+	// Clamp to make sure the points are on the line
+	s = fminf(fmaxf(s, 0), 1);
+	t = fminf(fmaxf(t, 0), 1);
+
+	// Compute points
+	*point_a = vec3_add(a_start, vec3_scale(a_dir, t));
+	*point_b = vec3_add(b_start, vec3_scale(b_dir, s));
+
+	// Return distance between points
+	const Vec3 dist_vec = vec3_sub(*point_b, *point_a);
+	return vec3_length(dist_vec);
+}
+
+bool collision_check_cubes(ContactManifold* const contact_manifold, Cube* const cube_a, Cube* const cube_b, const float t) {
+	Pose pose_a, pose_b;
+	BoxGeometry geometry_a_storage, geometry_b_storage;
+	const BoxGeometry* const geometry_a = probe_geometry(cube_a, t, &pose_a, &geometry_a_storage);
+	const BoxGeometry* const geometry_b = probe_geometry(cube_b, t, &pose_b, &geometry_b_storage);
+
+	if (!aabbs_overlap(geometry_a, geometry_b)) {
+		SIM_STATS.aabb_rejects++;
+		return false;
+	}
+
+	Vec3 normals[15];
+	// Face normals
+	normals[0] = geometry_a->face_normals[0];
+	normals[1] = geometry_a->face_normals[1];
+	normals[2] = geometry_a->face_normals[2];
+	normals[3] = geometry_b->face_normals[0];
+	normals[4] = geometry_b->face_normals[1];
+	normals[5] = geometry_b->face_normals[2];
+	// Edge normals (cross products between edges on both cubes)
+	normals[6] = vec3_normalize(vec3_cross(normals[0], normals[3]));
+	normals[7] = vec3_normalize(vec3_cross(normals[1], normals[3]));
+	normals[8] = vec3_normalize(vec3_cross(normals[2], normals[3]));
+	normals[9] = vec3_normalize(vec3_cross(normals[0], normals[4]));
+	normals[10] = vec3_normalize(vec3_cross(normals[1], normals[4]));
+	normals[11] = vec3_normalize(vec3_cross(normals[2], normals[4]));
+	normals[12] = vec3_normalize(vec3_cross(normals[0], normals[5]));
+	normals[13] = vec3_normalize(vec3_cross(normals[1], normals[5]));
+	normals[14] = vec3_normalize(vec3_cross(normals[2], normals[5]));
+
+	const PointsSoA corners_a = geometry_corners(geometry_a);
+	const PointsSoA corners_b = geometry_corners(geometry_b);
+
+	float a_mins[15], a_maxs[15];
+	float b_mins[15], b_maxs[15];
+	points_project(corners_a, 8, normals, 15, a_mins, a_maxs);
+	points_project(corners_b, 8, normals, 15, b_mins, b_maxs);
+
+	// Vertex indices of all edge pairs on a cube
+	const int edge_indices[12][2] = {
+		{ 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 }, // Bottom face
+		{ 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 4 }, // Top face
+		{ 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } // Connecting the faces
+	};
+
+	typedef enum {
+		CORNER_TO_FACE,
+		EDGE_TO_EDGE
+	} CollisionType;
+
+	CollisionType collision_type = CORNER_TO_FACE;
+	Vec3 min_penetration_axis; // This is the same as collision normal
+	float min_penetration_depth = FLT_MAX;
+	const Pose* penetrated_pose = &pose_a; // The cube whose face is min_penetration_axis
+	const PointsSoA* penetrating_corners = NULL; // Corners of the other cube
+	float penetrating_sign = 1; // +1 when the other cube's corners reach into the face along the normal, -1 otherwise
+
+	// Values for edge-to-edge collisiosn
+	Vec3 edge_a_start;
+	Vec3 edge_a_end;
+	Vec3 edge_b_start;
+	Vec3 edge_b_end;
+
+	// Project the corners of both cubes onto all normals
+	for (int normal_index = 0; normal_index < 15; normal_index++) {
+		if (vec3_length(normals[normal_index]) == 0) {
+			continue;
+		}
+
+		SIM_STATS.sat_axes_tested++;
+
+		const float a_min = a_mins[normal_index];
+		const float a_max = a_maxs[normal_index];
+		const float b_min = b_mins[normal_index];
+		const float b_max = b_maxs[normal_index];
+
+		// Look for separation along axis
+		if (a_max <= b_min || b_max <= a_min) {
+			SIM_STATS.sat_early_outs++;
+			return false;
+		}
+
+		// If corner-to-face collision
+		if (normal_index < 6) {
+			// Find axis of minimum penetration
+			const float overlap_below = fabsf(a_max - b_min); // a is on the negative side of the axis
+			const float overlap_above = fabsf(b_max - a_min); // a is on the positive side of the axis
+			const float penetration_depth = fminf(overlap_below, overlap_above);
+			if (penetration_depth < min_penetration_depth) {
+				min_penetration_depth = penetration_depth;
+				// The collision normal points from b towards a
+				min_penetration_axis = overlap_above <= overlap_below ? normals[normal_index] : vec3_scale(normals[normal_index], -1);
+				collision_type = CORNER_TO_FACE;
+				if (normal_index < 3) {
+					penetrated_pose = &pose_a;
+					penetrating_corners = &corners_b;
+					penetrating_sign = 1;
+				} else {
+					penetrated_pose = &pose_b;
+					penetrating_corners = &corners_a;
+					penetrating_sign = -1;
+				}
+			}
+		// If edge-to-edge collision
+		} else {
+			// Find vectors parallel to collision edges
+			Vec3 normal_a; // Vector parallel to the collision edges on cube a
+			Vec3 normal_b;
+
+			normal_a = normals[(normal_index - 6) % 3];
+			if (normal_index - 6 < 3) {
+				normal_b = normals[3];
+			} else if (normal_index - 6 < 6) {
+				normal_b = normals[4];
+			} else {
+				normal_b = normals[5];
+			}
+
+			// Find the edges that are parallel to the normals
+			Vec3 edges_a[4][2];
+			Vec3 edges_b[4][2];
+			int num_edges_a = 0;
+			int num_edges_b = 0;
+			for (int edge_index = 0; edge_index < 12; edge_index++) {
+				const Vec3 start_vertex_a = points_get(corners_a, edge_indices[edge_index][0]);
+				const Vec3 end_vertex_a = points_get(corners_a, edge_indices[edge_index][1]);
+				const Vec3 start_vertex_b = points_get(corners_b, edge_indices[edge_index][0]);
+				const Vec3 end_vertex_b = points_get(corners_b, edge_indices[edge_index][1]);
+
+				const Vec3 edge_a = vec3_sub(end_vertex_a, start_vertex_a);
+				const Vec3 edge_b = vec3_sub(end_vertex_b, start_vertex_b);
+
+				const Vec3 cross_product_a = vec3_cross(normal_a, edge_a);
+				if (fabsf(vec3_length(cross_product_a)) < 0.001) {
+					edges_a[num_edges_a][0] = start_vertex_a;
+					edges_a[num_edges_a++][1] = end_vertex_a;
+				}
+
+				const Vec3 cross_product_b = vec3_cross(normal_b, edge_b);
+				if (fabsf(vec3_length(cross_product_b)) < 0.001) {
+					edges_b[num_edges_b][0] = start_vertex_b;
+					edges_b[num_edges_b++][1] = end_vertex_b;
+				}
+			}
+
+			// Find edges of collision
+			Vec3 potential_edge_a_start;
+			Vec3 potential_edge_a_end;
+			Vec3 potential_edge_b_start;
+			Vec3 potential_edge_b_end;
+
+			float min_distance = FLT_MAX;
+			for (int edge_index_a = 0; edge_index_a < num_edges_a; edge_index_a++) {
+				const Vec3 start_vertex_a = edges_a[edge_index_a][0];
+				const Vec3 end_vertex_a = edges_a[edge_index_a][1];
+
+				for (int edge_index_b = 0; edge_index_b < num_edges_b; edge_index_b++) {
+					const Vec3 start_vertex_b = edges_b[edge_index_b][0];
+					const Vec3 end_vertex_b = edges_b[edge_index_b][1];
+
+					Vec3 point_a, point_b;
+					const float distance = closest_points_line_segments(start_vertex_a, end_vertex_a, start_vertex_b, end_vertex_b, &point_a, &point_b);
+
+					if (distance < min_distance) {
+						min_distance = distance;
+
+						potential_edge_a_start = start_vertex_a;
+						potential_edge_a_end = end_vertex_a;
+						potential_edge_b_start = start_vertex_b;
+						potential_edge_b_end = end_vertex_b;
+					}
+				}
+			}
+
+			if (min_distance < min_penetration_depth) {
+				collision_type = EDGE_TO_EDGE;
+
+				min_penetration_depth = min_distance;
+
+				// Check if normal should be flipped
+				const Vec3 displacement = vec3_sub(pose_b.position, pose_a.position);
+				if (vec3_dot(displacement, normals[normal_index]) > 0) {
+					min_penetration_axis = vec3_scale(normals[normal_index], -1);
+				} else {
+					min_penetration_axis = normals[normal_index];
+				}
+
+				edge_a_start = potential_edge_a_start;
+				edge_a_end = potential_edge_a_end;
+				edge_b_start = potential_edge_b_start;
+				edge_b_end = potential_edge_b_end;
+			}
+		}
+	}
+
+	Vec3 contact_point_a;
+	Vec3 contact_point_b;
+	float max_penetration_depth = -FLT_MAX;
+
+	// Find the contact points
+	if (collision_type == CORNER_TO_FACE) {
+		// Use the minimum penetration axis to calculate the point of contact
+		// Find the corner of the penetrating cube that reaches furthest into the face
+		Vec3 contact_point;
+		for (int vertex_index = 0; vertex_index < 8; vertex_index++) {
+			const Vec3 corner = points_get(*penetrating_corners, vertex_index);
+			const float penetration_depth = penetrating_sign * vec3_dot(corner, min_penetration_axis);
+			if (penetration_depth > max_penetration_depth) {
+				max_penetration_depth = penetration_depth;
+				contact_point = corner;
+			}
+		}
+
+		contact_point_a = pose_world_to_local(&pose_a, contact_point);
+		contact_point_b = pose_world_to_local(&pose_b, contact_point);
+
+		// Negative depth means penetration, like the floor contacts
+		max_penetration_depth = -min_penetration_depth;
+	} else {
+		Vec3 point_a, point_b;
+		max_penetration_depth = -closest_points_line_segments(edge_a_start, edge_a_end, edge_b_start, edge_b_end, &point_a, &point_b);
+
+		// Convert points to local space
+		const Vec3 local_point_a = pose_world_to_local(&pose_a, point_a);
+		const Vec3 local_point_b = pose_world_to_local(&pose_b, point_b);
+
+		contact_point_a = local_point_a;
+		contact_point_b = local_point_b;
+	}
+
+	if (contact_manifold->num_points >= MANIFOLD_POINTS) {
+		SIM_STATS.manifold_overflows++;
+		return true;
+	}
+
+	contact_manifold->local_points_a[contact_manifold->num_points] = contact_point_a;
+	contact_manifold->local_points_b[contact_manifold->num_points] = contact_point_b;
+	contact_manifold->depths[contact_manifold->num_points] = max_penetration_depth;
+	contact_manifold->cube_a = cube_a;
+	contact_manifold->cube_b = cube_b;
+	contact_manifold->normal = min_penetration_axis;
+	contact_manifold->num_points++;
+
+	if (collision_type == EDGE_TO_EDGE) {
+		buffer_collision_edges(edge_a_start, vec3_sub(edge_a_end, edge_a_start), edge_b_start, vec3_sub(edge_b_end, edge_b_start));
+		//sim_sleep_ms(1000);
+	}
+
+	buffer_collision_normal(penetrated_pose->position, min_penetration_axis);
+
+	//sim_pause();
+
+	/*
+	printf("point a: %f %f %f\n", contact_point_a.x, contact_point_a.y, contact_point_a.z);
+	printf("point b: %f %f %f\n", contact_point_b.x, contact_point_b.y, contact_point_b.z);
+	*/
+	//printf("normal: %f %f %f\n", min_penetration_axis.x, min_penetration_axis.y, min_penetration_axis.z);
+	//printf("num_points: %d\n", contact_manifold->num_points);
+
+	return true;
+}
+
+// Contact between spheres around two points, normal from b towards a
+bool sphere_sphere_contact(const Vec3 center_a, const float radius_a, const Vec3 center_b, const float radius_b, Vec3* const point, Vec3* const normal, float* const depth) {
+	const Vec3 offset = vec3_sub(center_a, center_b);
+	const float distance = vec3_length(offset);
+
+	*depth = distance - radius_a - radius_b;
+	if (*depth >= 0) {
+		return false;
+	}
+
+	// Concentric spheres have no direction to separate in, push a upwards
+	*normal = distance > 0 ? vec3_scale(offset, 1 / distance) : new_vec3(0, 1, 0);
+	// Halfway between the two surfaces
+	*point = vec3_add(center_b, vec3_scale(*normal, radius_b + *depth / 2));
+	return true;
+}
+
+// Closest point to point on or inside a box
+Vec3 box_closest_point(const Pose* const box_pose, const Vec3 half_extents, const Vec3 point) {
+	const Vec3 local_point = rotate_to_local(&box_pose->orientation, vec3_sub(point, box_pose->position));
+	const Vec3 clamped = {
+		fminf(fmaxf(local_point.x, -half_extents.x), half_extents.x),
+		fminf(fmaxf(local_point.y, -half_extents.y), half_extents.y),
+		fminf(fmaxf(local_point.z, -half_extents.z), half_extents.z)
+	};
+	return vec3_add(vec3_mul_mat3(clamped, &box_pose->orientation), box_pose->position);
+}
+
+// Contact between a sphere and a box, normal from the box towards the sphere
+bool sphere_box_contact(const Vec3 center, const float radius, const Pose* const box_pose, const Vec3 half_extents, Vec3* const point, Vec3* const normal, float* const depth) {
+	const Vec3 local_center = rotate_to_local(&box_pose->orientation, vec3_sub(center, box_pose->position));
+	Vec3 local_point = {
+		fminf(fmaxf(local_center.x, -half_extents.x), half_extents.x),
+		fminf(fmaxf(local_center.y, -half_extents.y), half_extents.y),
+		fminf(fmaxf(local_center.z, -half_extents.z), half_extents.z)
+	};
+
+	const Vec3 offset = vec3_sub(local_center, local_point);
+	const float distance = vec3_length(offset);
+	Vec3 local_normal;
+
+	if (distance > 0) {
+		*depth = distance - radius;
+		if (*depth >= 0) {
+			return false;
+		}
+		local_normal = vec3_scale(offset, 1 / distance);
+	} else {
+		// The center is inside the box, push the sphere out through the nearest face
+		const float* const center_axes = &local_center.x;
+		const float* const extent_axes = &half_extents.x;
+		int axis = 0;
+		float face_distance = FLT_MAX;
+		for (int i = 0; i < 3; i++) {
+			const float distance_to_face = extent_axes[i] - fabsf(center_axes[i]);
+			if (distance_to_face < face_distance) {
+				face_distance = distance_to_face;
+				axis = i;
+			}
+		}
+
+		float normal_axes[3] = { 0, 0, 0 };
+		normal_axes[axis] = center_axes[axis] < 0 ? -1 : 1;
+		local_normal = new_vec3(normal_axes[0], normal_axes[1], normal_axes[2]);
+		(&local_point.x)[axis] = normal_axes[axis] * extent_axes[axis];
+		*depth = -(face_distance + radius);
+	}
+
+	*normal = vec3_mul_mat3(local_normal, &box_pose->orientation);
+	*point = vec3_add(vec3_mul_mat3(local_point, &box_pose->orientation), box_pose->position);
+	return true;
+}
+
+bool collision_check_spheres(ContactManifold* const contact_manifold, Cube* const sphere_a, Cube* const sphere_b, const float t) {
+	const Pose pose_a = probe_pose(sphere_a, t);
+	const Pose pose_b = probe_pose(sphere_b, t);
+
+	Vec3 point, normal;
+	float depth;
+	if (!sphere_sphere_contact(pose_a.position, sphere_a->radius, pose_b.position, sphere_b->radius, &point, &normal, &depth)) {
+		return false;
+	}
+
+	manifold_add_point(contact_manifold, sphere_a, sphere_b, &pose_a, &pose_b, point, normal, depth);
+	return true;
+}
+
+bool collision_check_sphere_capsule(ContactManifold* const contact_manifold, Cube* const sphere, Cube* const capsule, const float t) {
+	const Pose pose_a = probe_pose(sphere, t);
+	const Pose pose_b = probe_pose(capsule, t);
+
+	Vec3 start, end;
+	shape_segment(capsule, &pose_b, &start, &end);
+	const Vec3 closest = closest_point_line_segment(start, end, pose_a.position);
+
+	Vec3 point, normal;
+	float depth;
+	if (!sphere_sphere_contact(pose_a.position, sphere->radius, closest, capsule->radius, &point, &normal, &depth)) {
+		return false;
+	}
+
+	manifold_add_point(contact_manifold, sphere, capsule, &pose_a, &pose_b, point, normal, depth);
+	return true;
+}
+
+bool collision_check_capsules(ContactManifold* const contact_manifold, Cube* const capsule_a, Cube* const capsule_b, const float t) {
+	const Pose pose_a = probe_pose(capsule_a, t);
+	const Pose pose_b = probe_pose(capsule_b, t);
+
+	Vec3 start_a, end_a, start_b, end_b;
+	shape_segment(capsule_a, &pose_a, &start_a, &end_a);
+	shape_segment(capsule_b, &pose_b, &start_b, &end_b);
+
+	// Side by side capsules touch along the whole overlap, a contact at each end of it keeps them
+	// from rolling about a single point
+	float low = 0, high = 0;
+	if (segments_parallel(vec3_sub(end_a, start_a), vec3_sub(end_b, start_b))) {
+		segment_overlap(start_a, end_a, start_b, end_b, &low, &high);
+	}
+
+	const float overlap_length = (high - low) * vec3_length(vec3_sub(end_a, start_a));
+	const int num_points = overlap_length > COLLISION_DIST_TOLERANCE ? 2 : 1;
+	bool touching = false;
+	for (int i = 0; i < num_points; i++) {
+		Vec3 closest_a, closest_b;
+		if (num_points == 2) {
+			closest_a = vec3_add(start_a, vec3_scale(vec3_sub(end_a, start_a), i == 0 ? low : high));
+			closest_b = closest_point_line_segment(start_b, end_b, closest_a);
+		} else {
+			closest_points_line_segments(start_a, end_a, start_b, end_b, &closest_a, &closest_b);
+		}
+
+		Vec3 point, normal;
+		float depth;
+		if (!sphere_sphere_contact(closest_a, capsule_a->radius, closest_b, capsule_b->radius, &point, &normal, &depth)) {
+			continue;
+		}
+
+		manifold_add_point(contact_manifold, capsule_a, capsule_b, &pose_a, &pose_b, point, normal, depth);
+		touching = true;
+	}
+
+	return touching;
+}
+
+bool collision_check_sphere_box(ContactManifold* const contact_manifold, Cube* const sphere, Cube* const box, const float t) {
+	const Pose pose_a = probe_pose(sphere, t);
+	const Pose pose_b = probe_pose(box, t);
+
+	Vec3 point, normal;
+	float depth;
+	if (!sphere_box_contact(pose_a.position, sphere->radius, &pose_b, box->half_extents, &point, &normal, &depth)) {
+		return false;
+	}
+
+	manifold_add_point(contact_manifold, sphere, box, &pose_a, &pose_b, point, normal, depth);
+	return true;
+}
+
+// Tests spheres around both segment ends and around the segment point closest to the box,
+// so a capsule lying on a box gets a contact at each end
+bool collision_check_capsule_box(ContactManifold* const contact_manifold, Cube* const capsule, Cube* const box, const float t) {
+	const Pose pose_a = probe_pose(capsule, t);
+	const Pose pose_b = probe_pose(box, t);
+
+	Vec3 start, end;
+	shape_segment(capsule, &pose_a, &start, &end);
+
+	// Alternate between the closest point on the segment and on the box, two rounds
+	// settle on the closest pair for all but grazing configurations
+	Vec3 closest = closest_point_line_segment(start, end, pose_b.position);
+	for (int i = 0; i < 2; i++) {
+		closest = closest_point_line_segment(start, end, box_closest_point(&pose_b, box->half_extents, closest));
+	}
+
+	const Vec3 centers[3] = { start, end, closest };
+	float deepest = FLT_MAX;
+	Vec3 deepest_normal;
+	for (int i = 0; i < 3; i++) {
+		// The closest point often is one of the ends
+		if (i == 2 && (vec3_length(vec3_sub(closest, start)) < COLLISION_DIST_TOLERANCE || vec3_length(vec3_sub(closest, end)) < COLLISION_DIST_TOLERANCE)) {
+			break;
+		}
+
+		Vec3 point, normal;
+		float depth;
+		if (!sphere_box_contact(centers[i], capsule->radius, &pose_b, box->half_extents, &point, &normal, &depth)) {
+			continue;
+		}
+
+		manifold_add_point(contact_manifold, capsule, box, &pose_a, &pose_b, point, normal, depth);
+		if (depth < deepest) {
+			deepest = depth;
+			deepest_normal = normal;
+		}
+	}
+
+	if (deepest == FLT_MAX) {
+		return false;
+	}
+
+	// A manifold has a single normal, use the one of the deepest contact
+	contact_manifold->normal = deepest_normal;
+	return true;
+}
+
+// Support mapping of any shape in body space for GJK
+Vec3 body_support(void* const shape, const Vec3 direction) {
+	SupportContext* const context = shape;
+	const Cube* const cube = context->cube;
+
+	switch (cube->shape) {
+		case SHAPE_BOX: {
+			const Vec3 half_extents = cube->half_extents;
+			return new_vec3(
+				direction.x < 0 ? -half_extents.x : half_extents.x,
+				direction.y < 0 ? -half_extents.y : half_extents.y,
+				direction.z < 0 ? -half_extents.z : half_extents.z);
+		}
+		case SHAPE_SPHERE:
+		case SHAPE_CAPSULE: {
+			const Vec3 end = new_vec3(0, direction.y < 0 ? -cube->half_height : cube->half_height, 0);
+			return vec3_add(end, vec3_scale(vec3_normalize(direction), cube->radius));
+		}
+		case SHAPE_HULL: {
+			return cube->hull->vertices[convex_hull_support(cube->hull, direction, &context->hint)];
+		}
+		default: {
+			return (Vec3){};
+		}
+	}
+}
+
+// GJK and EPA on the support mappings of both shapes, warm started from the pair's last simplex
+bool collision_check_convex(ContactManifold* const contact_manifold, Cube* const cube_a, Cube* const cube_b, const float t) {
+	SupportContext context_a = { cube_a, 0 };
+	SupportContext context_b = { cube_b, 0 };
+	const ConvexProxy proxy_a = { body_support, &context_a, probe_pose(cube_a, t) };
+	const ConvexProxy proxy_b = { body_support, &context_b, probe_pose(cube_b, t) };
+
+	// Compound children have no index of their own and start cold
+	GjkSimplex cold_simplex = {};
+	GjkSimplex* const simplex = cube_a->index >= 0 && cube_b->index >= 0 ? simplex_cache_find(cube_a->index, cube_b->index) : &cold_simplex;
+	const GjkResult distance = gjk_distance(&proxy_a, &proxy_b, simplex, &SIM_STATS.gjk_iterations);
+	if (!distance.intersecting) {
+		return false;
+	}
+
+	EpaResult penetration;
+	if (!epa_penetration(&proxy_a, &proxy_b, simplex, &penetration, &SIM_STATS.epa_iterations)) {
+		return false;
+	}
+
+	const Vec3 point = vec3_scale(vec3_add(penetration.point_a, penetration.point_b), 0.5f);
+	manifold_add_point(contact_manifold, cube_a, cube_b, &proxy_a.pose, &proxy_b.pose, point, penetration.normal, -penetration.depth);
+	return true;
+}
+
+// Closest point to point on the triangle a, b, c, from the region tests in Ericson's Real-Time Collision Detection
+Vec3 closest_point_triangle(const Vec3 point, const Vec3 a, const Vec3 b, const Vec3 c) {
+	const Vec3 ab = vec3_sub(b, a);
+	const Vec3 ac = vec3_sub(c, a);
+	const Vec3 ap = vec3_sub(point, a);
+	const float d1 = vec3_dot(ab, ap);
+	const float d2 = vec3_dot(ac, ap);
+	if (d1 <= 0 && d2 <= 0) {
+		return a;
+	}
+
+	const Vec3 bp = vec3_sub(point, b);
+	const float d3 = vec3_dot(ab, bp);
+	const float d4 = vec3_dot(ac, bp);
+	if (d3 >= 0 && d4 <= d3) {
+		return b;
+	}
+
+	const float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+		return vec3_add(a, vec3_scale(ab, d1 / (d1 - d3)));
+	}
+
+	const Vec3 cp = vec3_sub(point, c);
+	const float d5 = vec3_dot(ab, cp);
+	const float d6 = vec3_dot(ac, cp);
+	if (d6 >= 0 && d5 <= d6) {
+		return c;
+	}
+
+	const float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+		return vec3_add(a, vec3_scale(ac, d2 / (d2 - d6)));
+	}
+
+	const float va = d3 * d6 - d5 * d4;
+	if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+		return vec3_add(b, vec3_scale(vec3_sub(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+	}
+
+	const float denominator = 1 / (va + vb + vc);
+	return vec3_add(a, vec3_add(vec3_scale(ab, vb * denominator), vec3_scale(ac, vc * denominator)));
+}
+
+Vec3 triangle_normal(const Vec3* const triangle) {
+	return vec3_normalize(vec3_cross(vec3_sub(triangle[1], triangle[0]), vec3_sub(triangle[2], triangle[0])));
+}
+
+// Whether the projection of point along normal falls inside the triangle
+bool triangle_contains_projection(const Vec3* const triangle, const Vec3 normal, const Vec3 point) {
+	for (int i = 0; i < 3; i++) {
+		const Vec3 edge = vec3_sub(triangle[(i + 1) % 3], triangle[i]);
+		if (vec3_dot(vec3_cross(edge, vec3_sub(point, triangle[i])), normal) < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Support mapping of a triangle given as three points, for GJK
+Vec3 triangle_support(void* const shape, const Vec3 direction) {
+	const Vec3* const triangle = shape;
+	int best = 0;
+	for (int i = 1; i < 3; i++) {
+		if (vec3_dot(triangle[i], direction) > vec3_dot(triangle[best], direction)) {
+			best = i;
+		}
+	}
+	return triangle[best];
+}
+
+// Contact of a mesh triangle with a body, all in world space with the normal pointing from the triangle to the body
+typedef struct {
+	Vec3 point;
+	Vec3 normal;
+	float depth;
+	int feature; // Sphere of a capsule or corner of a box making the contact, -1 for others
+} TriangleContact;
+
+enum {
+	TRIANGLE_MAX_CONTACTS = 4
+};
+
+// Smallest cosine between the normal of a contact and the deepest one for both to share a manifold
+static const float MANIFOLD_NORMAL_AGREEMENT = 0.7f;
+
+int sphere_triangle_contacts(const Vec3 center, const float radius, const Vec3* const triangle, TriangleContact* const contacts) {
+	const Vec3 closest = closest_point_triangle(center, triangle[0], triangle[1], triangle[2]);
+	const Vec3 offset = vec3_sub(center, closest);
+	const float distance = vec3_length(offset);
+	if (distance >= radius) {
+		return 0;
+	}
+
+	contacts[0].point = closest;
+	contacts[0].normal = distance > 0 ? vec3_scale(offset, 1 / distance) : triangle_normal(triangle);
+	contacts[0].depth = distance - radius;
+	contacts[0].feature = 0;
+	return 1;
+}
+
+// Spheres at both segment ends and at the segment point closest to the triangle, like capsule-box
+int capsule_triangle_contacts(const Vec3 start, const Vec3 end, const float radius, const Vec3* const triangle, TriangleContact* const contacts) {
+	const Vec3 centroid = vec3_scale(vec3_add(vec3_add(triangle[0], triangle[1]), triangle[2]), 1.f / 3);
+	Vec3 closest = closest_point_line_segment(start, end, centroid);
+	for (int i = 0; i < 2; i++) {
+		closest = closest_point_line_segment(start, end, closest_point_triangle(closest, triangle[0], triangle[1], triangle[2]));
+	}
+
+	const Vec3 centers[3] = { start, end, closest };
+	int num_contacts = 0;
+	for (int i = 0; i < 3; i++) {
+		if (i == 2 && (vec3_length(vec3_sub(closest, start)) < COLLISION_DIST_TOLERANCE || vec3_length(vec3_sub(closest, end)) < COLLISION_DIST_TOLERANCE)) {
+			break;
+		}
+		if (sphere_triangle_contacts(centers[i], radius, triangle, contacts + num_contacts)) {
+			contacts[num_contacts++].feature = i;
+		}
+	}
+
+	return num_contacts;
+}
+
+// Single contact from GJK and EPA, for hulls and for boxes touching a triangle edge
+int convex_triangle_contacts(const Cube* const body, const Pose* const pose, const Vec3* const triangle, TriangleContact* const contacts) {
+	SupportContext context = { body, 0 };
+	const ConvexProxy proxy_a = { body_support, &context, *pose };
+	const ConvexProxy proxy_b = { triangle_support, (void*)triangle, { { 0, 0, 0 }, MAT3_IDENTITY } };
+
+	GjkSimplex simplex = {};
+	if (!gjk_distance(&proxy_a, &proxy_b, &simplex, &SIM_STATS.gjk_iterations).intersecting) {
+		return 0;
+	}
+
+	EpaResult penetration;
+	if (!epa_penetration(&proxy_a, &proxy_b, &simplex, &penetration, &SIM_STATS.epa_iterations)) {
+		return 0;
+	}
+
+	contacts[0].point = vec3_scale(vec3_add(penetration.point_a, penetration.point_b), 0.5f);
+	contacts[0].normal = penetration.normal;
+	contacts[0].depth = -penetration.depth;
+	contacts[0].feature = -1;
+	return 1;
+}
+
+// Keeps the deepest contacts when more than TRIANGLE_MAX_CONTACTS are found
+void triangle_contacts_add(TriangleContact* const contacts, int* const num_contacts, const Vec3 point, const Vec3 normal, const float depth, const int feature) {
+	int slot = *num_contacts;
+	if (*num_contacts == TRIANGLE_MAX_CONTACTS) {
+		slot = 0;
+		for (int k = 1; k < *num_contacts; k++) {
+			if (contacts[k].depth > contacts[slot].depth) {
+				slot = k;
+			}
+		}
+		if (depth >= contacts[slot].depth) {
+			return;
+		}
+	} else {
+		(*num_contacts)++;
+	}
+
+	contacts[slot].point = point;
+	contacts[slot].normal = normal;
+	contacts[slot].depth = depth;
+	contacts[slot].feature = feature;
+}
+
+// Separating axis test over the triangle normal, the box axes and their cross products with
+// the triangle edges. When a face separates the least, the contacts are the box corners under
+// the triangle and the triangle vertices inside the box, so a box lying across many small
+// triangles needs no GJK. Edge contacts fall back to a single GJK contact.
+int box_triangle_contacts(const Cube* const box, const Pose* const pose, const BoxGeometry* const geometry, const Vec3* const triangle, TriangleContact* const contacts) {
+	const Vec3 normal = triangle_normal(triangle);
+	const Vec3 half_extents = box->half_extents;
+
+	Vec3 axes[13];
+	int num_axes = 0;
+	axes[num_axes++] = normal;
+	for (int i = 0; i < 3; i++) {
+		axes[num_axes++] = geometry->face_normals[i];
+	}
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			const Vec3 axis = vec3_cross(geometry->face_normals[i], vec3_sub(triangle[(j + 1) % 3], triangle[j]));
+			const float length = vec3_length(axis);
+			if (length > 1e-6f) {
+				axes[num_axes++] = vec3_scale(axis, 1 / length);
+			}
+		}
+	}
+
+	// No axis wins when the overlaps are not finite, the general test handles that case
+	int min_axis = -1;
+	float min_overlap = FLT_MAX;
+	Vec3 min_normal = normal; // min_axis pointing from the triangle towards the box
+	float min_radius = 0;
+	for (int i = 0; i < num_axes; i++) {
+		const Vec3 axis = axes[i];
+		const float center = vec3_dot(pose->position, axis);
+		const float radius =
+			half_extents.x * fabsf(vec3_dot(geometry->face_normals[0], axis)) +
+			half_extents.y * fabsf(vec3_dot(geometry->face_normals[1], axis)) +
+			half_extents.z * fabsf(vec3_dot(geometry->face_normals[2], axis));
+
+		float triangle_min = vec3_dot(triangle[0], axis);
+		float triangle_max = triangle_min;
+		for (int v = 1; v < 3; v++) {
+			const float projection = vec3_dot(triangle[v], axis);
+			triangle_min = fminf(triangle_min, projection);
+			triangle_max = fmaxf(triangle_max, projection);
+		}
+
+		if (center + radius <= triangle_min || triangle_max <= center - radius) {
+			return 0;
+		}
+
+		// Triangles are one sided, the face always pushes towards its front
+		const float overlap_above = triangle_max - (center - radius);
+		const float overlap_below = center + radius - triangle_min;
+		const bool above = i == 0 || overlap_above <= overlap_below;
+		const float overlap = above ? overlap_above : overlap_below;
+		if (overlap < min_overlap) {
+			min_overlap = overlap;
+			min_axis = i;
+			min_normal = above ? axis : vec3_scale(axis, -1);
+			min_radius = radius;
+		}
+	}
+
+	int num_contacts = 0;
+	if (min_axis >= 0 && min_axis < 4) {
+		// Box corners under the triangle face
+		if (min_axis == 0) {
+			const float plane = vec3_dot(triangle[0], normal);
+			const PointsSoA corners = geometry_corners(geometry);
+			for (int i = 0; i < 8; i++) {
+				const Vec3 corner = points_get(corners, i);
+				const float depth = vec3_dot(corner, normal) - plane;
+				if (depth < 0 && triangle_contains_projection(triangle, normal, corner)) {
+					triangle_contacts_add(contacts, &num_contacts, corner, normal, depth, i);
+				}
+			}
+		}
+
+		// Triangle vertices inside the box, as deep as the box's lowest point along the normal
+		const float box_bottom = vec3_dot(pose->position, min_normal) - min_radius;
+		for (int v = 0; v < 3; v++) {
+			const Vec3 local = rotate_to_local(&pose->orientation, vec3_sub(triangle[v], pose->position));
+			if (fabsf(local.x) <= half_extents.x && fabsf(local.y) <= half_extents.y && fabsf(local.z) <= half_extents.z) {
+				triangle_contacts_add(contacts, &num_contacts, triangle[v], min_normal, box_bottom - vec3_dot(triangle[v], min_normal), -1);
+			}
+		}
+	}
+
+	if (num_contacts == 0) {
+		num_contacts = convex_triangle_contacts(box, pose, triangle, contacts);
+	}
+
+	return num_contacts;
+}
+
+// Body space box around a world space box
+void bounds_to_local(const Pose* const pose, const Vec3 min, const Vec3 max, Vec3* const local_min, Vec3* const local_max) {
+	const Vec3 center = vec3_scale(vec3_add(min, max), 0.5f);
+	const Vec3 extent = vec3_scale(vec3_sub(max, min), 0.5f);
+	const Vec3 local_center = rotate_to_local(&pose->orientation, vec3_sub(center, pose->position));
+	const float (*const m)[3] = pose->orientation.m;
+	const Vec3 local_extent = {
+		fabsf(m[0][0]) * extent.x + fabsf(m[1][0]) * extent.y + fabsf(m[2][0]) * extent.z,
+		fabsf(m[0][1]) * extent.x + fabsf(m[1][1]) * extent.y + fabsf(m[2][1]) * extent.z,
+		fabsf(m[0][2]) * extent.x + fabsf(m[1][2]) * extent.y + fabsf(m[2][2]) * extent.z
+	};
+
+	*local_min = vec3_sub(local_center, local_extent);
+	*local_max = vec3_add(local_center, local_extent);
+}
+
+// Contacts of a body with the triangles of a static mesh or heightfield. Neighbouring triangles
+// report the same contact at shared edges and vertices, only the deepest of each is kept. A sphere
+// over an edge also touches the edge of the next triangle, so each body feature keeps one contact.
+typedef struct {
+	Cube* body;
+	Cube* static_body;
+	Pose pose_a;
+	Pose pose_b;
+	const BoxGeometry* geometry;
+	BoxGeometry geometry_storage;
+	float bounding_radius;
+
+	TriangleContact contacts[MANIFOLD_POINTS];
+	int num_contacts;
+	int deepest; // -1 without contacts
+} TriangleCollision;
+
+// Probes both bodies and returns the body's bounds in the static body's body space
+void triangle_collision_begin(TriangleCollision* const collision, Cube* const body, Cube* const static_body, const float t, Vec3* const local_min, Vec3* const local_max) {
+	collision->body = body;
+	collision->static_body = static_body;
+	collision->geometry = probe_geometry(body, t, &collision->pose_a, &collision->geometry_storage);
+	collision->pose_b = probe_pose(static_body, t);
+	collision->bounding_radius = vec3_length(body->half_extents);
+	collision->num_contacts = 0;
+	collision->deepest = -1;
+
+	bounds_to_local(&collision->pose_b, collision->geometry->aabb_min, collision->geometry->aabb_max, local_min, local_max);
+}
+
+// Tests one triangle given in the static body's body space
+void triangle_collision_add(TriangleCollision* const collision, const Vec3* const local_triangle) {
+	SIM_STATS.mesh_triangles++;
+
+	const Cube* const body = collision->body;
+	const Pose* const pose_a = &collision->pose_a;
+	Vec3 triangle[3];
+	for (int v = 0; v < 3; v++) {
+		triangle[v] = pose_to_world(&collision->pose_b, local_triangle[v]);
+	}
+
+	// Cheap rejection by the sphere around the body before the exact tests
+	const Vec3 closest = closest_point_triangle(pose_a->position, triangle[0], triangle[1], triangle[2]);
+	if (vec3_length(vec3_sub(closest, pose_a->position)) >= collision->bounding_radius) {
+		return;
+	}
+
+	TriangleContact contacts[TRIANGLE_MAX_CONTACTS];
+	int num_contacts;
+	switch (body->shape) {
+		case SHAPE_SPHERE: {
+			num_contacts = sphere_triangle_contacts(pose_a->position, body->radius, triangle, contacts);
+			break;
+		}
+		case SHAPE_CAPSULE: {
+			Vec3 start, end;
+			shape_segment(body, pose_a, &start, &end);
+			num_contacts = capsule_triangle_contacts(start, end, body->radius, triangle, contacts);
+			break;
+		}
+		case SHAPE_BOX: {
+			num_contacts = box_triangle_contacts(body, pose_a, collision->geometry, triangle, contacts);
+			break;
+		}
+		default: {
+			num_contacts = convex_triangle_contacts(body, pose_a, triangle, contacts);
+			break;
+		}
+	}
+
+	for (int i = 0; i < num_contacts; i++) {
+		int slot = collision->num_contacts;
+		for (int j = 0; j < collision->num_contacts; j++) {
+			const TriangleContact* const existing = &collision->contacts[j];
+			const bool same_feature = contacts[i].feature >= 0 && existing->feature == contacts[i].feature;
+			if (same_feature || vec3_length(vec3_sub(existing->point, contacts[i].point)) < COLLISION_DIST_TOLERANCE) {
+				slot = j;
+				break;
+			}
+		}
+
+		if (slot == collision->num_contacts) {
+			if (collision->num_contacts == MANIFOLD_POINTS) {
+				SIM_STATS.manifold_overflows++;
+				continue;
+			}
+			collision->num_contacts++;
+		} else if (contacts[i].depth >= collision->contacts[slot].depth) {
+			continue;
+		}
+
+		collision->contacts[slot] = contacts[i];
+		if (collision->deepest < 0 || contacts[i].depth < collision->contacts[collision->deepest].depth) {
+			collision->deepest = slot;
+		}
+	}
+}
+
+// Moves the contacts into the manifold, which takes the normal of the deepest one
+bool triangle_collision_end(TriangleCollision* const collision, ContactManifold* const contact_manifold) {
+	if (collision->deepest < 0) {
+		return false;
+	}
+
+	// The manifold has a single normal, contacts facing elsewhere belong to another side of the body
+	const Vec3 normal = collision->contacts[collision->deepest].normal;
+	for (int i = 0; i < collision->num_contacts; i++) {
+		const TriangleContact* const contact = &collision->contacts[i];
+		if (vec3_dot(contact->normal, normal) >= MANIFOLD_NORMAL_AGREEMENT) {
+			manifold_add_point(contact_manifold, collision->body, collision->static_body, &collision->pose_a, &collision->pose_b, contact->point, normal, contact->depth);
+		}
+	}
+
+	return true;
+}
+
+void triangle_collision_query_callback(void* const context, const Vec3* const triangle) {
+	triangle_collision_add(context, triangle);
+}
+
+// Tests a body against the triangles of a static mesh under its bounds
+bool collision_check_mesh(ContactManifold* const contact_manifold, Cube* const body, Cube* const mesh_body, const float t) {
+	TriangleCollision collision;
+	Vec3 min, max;
+	triangle_collision_begin(&collision, body, mesh_body, t, &min, &max);
+
+	triangle_mesh_query(mesh_body->mesh, min, max, triangle_collision_query_callback, &collision);
+
+	return triangle_collision_end(&collision, contact_manifold);
+}
+
+// Tests a body against the heightfield cells under its bounds, looked up directly from the grid
+bool collision_check_heightfield(ContactManifold* const contact_manifold, Cube* const body, Cube* const heightfield_body, const float t) {
+	TriangleCollision collision;
+	Vec3 min, max;
+	triangle_collision_begin(&collision, body, heightfield_body, t, &min, &max);
+
+	const Heightfield* const heightfield = heightfield_body->heightfield;
+	int first_column, first_row, last_column, last_row;
+	if (!heightfield_cell_range(heightfield, min, max, &first_column, &first_row, &last_column, &last_row)) {
+		return false;
+	}
+
+	for (int row = first_row; row <= last_row; row++) {
+		for (int column = first_column; column <= last_column; column++) {
+			Vec3 triangles[2][3];
+			if (heightfield_cell_triangles(heightfield, column, row, min.y, triangles)) {
+				triangle_collision_add(&collision, triangles[0]);
+				triangle_collision_add(&collision, triangles[1]);
+			}
+		}
+	}
+
+	return triangle_collision_end(&collision, contact_manifold);
+}
+
+typedef bool (*CollisionCheck)(ContactManifold* const contact_manifold, Cube* const cube_a, Cube* const cube_b, const float t);
+
+// Runs a pair test with the bodies swapped and turns the result around so cube_a stays first
+bool collision_check_swapped(const CollisionCheck check, ContactManifold* const contact_manifold, Cube* const cube_a, Cube* const cube_b, const float t) {
+	ContactManifold swapped = {};
+	if (!check(&swapped, cube_b, cube_a, t)) {
+		return false;
+	}
+
+	for (int i = 0; i < swapped.num_points; i++) {
+		if (contact_manifold->num_points >= MANIFOLD_POINTS) {
+			SIM_STATS.manifold_overflows++;
+			break;
+		}
+
+		const int index = contact_manifold->num_points++;
+		contact_manifold->local_points_a[index] = swapped.local_points_b[i];
+		contact_manifold->local_points_b[index] = swapped.local_points_a[i];
+		contact_manifold->depths[index] = swapped.depths[i];
+	}
+
+	contact_manifold->normal = vec3_scale(swapped.normal, -1);
+	contact_manifold->cube_a = cube_a;
+	contact_manifold->cube_b = cube_b;
+	return true;
+}
+
+bool collision_check_capsule_sphere(ContactManifold* const contact_manifold, Cube* const capsule, Cube* const sphere, const float t) {
+	return collision_check_swapped(collision_check_sphere_capsule, contact_manifold, capsule, sphere, t);
+}
+
+bool collision_check_box_sphere(ContactManifold* const contact_manifold, Cube* const box, Cube* const sphere, const float t) {
+	return collision_check_swapped(collision_check_sphere_box, contact_manifold, box, sphere, t);
+}
+
+bool collision_check_box_capsule(ContactManifold* const contact_manifold, Cube* const box, Cube* const capsule, const float t) {
+	return collision_check_swapped(collision_check_capsule_box, contact_manifold, box, capsule, t);
+}
+
+bool collision_check_mesh_body(ContactManifold* const contact_manifold, Cube* const mesh_body, Cube* const body, const float t) {
+	return collision_check_swapped(collision_check_mesh, contact_manifold, mesh_body, body, t);
+}
+
+bool collision_check_heightfield_body(ContactManifold* const contact_manifold, Cube* const heightfield_body, Cube* const body, const float t) {
+	return collision_check_swapped(collision_check_heightfield, contact_manifold, heightfield_body, body, t);
+}
+
+// Narrowphase routine for each pair of shapes, indexed by the shapes of cube_a and cube_b.
+// Meshes and heightfields are static, so two of them never meet. Compounds never get here,
+// collision_check_pair splits them into their children first.
+static const CollisionCheck COLLISION_CHECKS[SHAPE_COUNT][SHAPE_COUNT] = {
+	[SHAPE_BOX] = {
+		[SHAPE_BOX] = collision_check_cubes,
+		[SHAPE_SPHERE] = collision_check_box_sphere,
+		[SHAPE_CAPSULE] = collision_check_box_capsule,
+		[SHAPE_HULL] = collision_check_convex,
+		[SHAPE_MESH] = collision_check_mesh,
+		[SHAPE_HEIGHTFIELD] = collision_check_heightfield
+	},
+	[SHAPE_SPHERE] = {
+		[SHAPE_BOX] = collision_check_sphere_box,
+		[SHAPE_SPHERE] = collision_check_spheres,
+		[SHAPE_CAPSULE] = collision_check_sphere_capsule,
+		[SHAPE_HULL] = collision_check_convex,
+		[SHAPE_MESH] = collision_check_mesh,
+		[SHAPE_HEIGHTFIELD] = collision_check_heightfield
+	},
+	[SHAPE_CAPSULE] = {
+		[SHAPE_BOX] = collision_check_capsule_box,
+		[SHAPE_SPHERE] = collision_check_capsule_sphere,
+		[SHAPE_CAPSULE] = collision_check_capsules,
+		[SHAPE_HULL] = collision_check_convex,
+		[SHAPE_MESH] = collision_check_mesh,
+		[SHAPE_HEIGHTFIELD] = collision_check_heightfield
+	},
+	[SHAPE_HULL] = {
+		[SHAPE_BOX] = collision_check_convex,
+		[SHAPE_SPHERE] = collision_check_convex,
+		[SHAPE_CAPSULE] = collision_check_convex,
+		[SHAPE_HULL] = collision_check_convex,
+		[SHAPE_MESH] = collision_check_mesh,
+		[SHAPE_HEIGHTFIELD] = collision_check_heightfield
+	},
+	[SHAPE_MESH] = {
+		[SHAPE_BOX] = collision_check_mesh_body,
+		[SHAPE_SPHERE] = collision_check_mesh_body,
+		[SHAPE_CAPSULE] = collision_check_mesh_body,
+		[SHAPE_HULL] = collision_check_mesh_body
+	},
+	[SHAPE_HEIGHTFIELD] = {
+		[SHAPE_BOX] = collision_check_heightfield_body,
+		[SHAPE_SPHERE] = collision_check_heightfield_body,
+		[SHAPE_CAPSULE] = collision_check_heightfield_body,
+		[SHAPE_HULL] = collision_check_heightfield_body
+	}
+};
+
+bool collision_check_shapes(ContactManifold* const contact_manifold, Cube* const cube_a, Cube* const cube_b, const float t) {
+	const CollisionCheck check = COLLISION_CHECKS[cube_a->shape][cube_b->shape];
+	return check ? check(contact_manifold, cube_a, cube_b, t) : false;
+}
+
+// Stand-in body for a child of a compound at the compound's pose. Its index of -1 keeps it out
+// of the per pair caches of real bodies.
+void compound_child_body(Cube* const child_body, const Cube* const compound_body, const CompoundChild* const child, const Pose* const pose) {
+	*child_body = (Cube){};
+	child_body->index = -1;
+	child_body->type = compound_body->type;
+	child_body->shape = child->shape;
+	child_body->half_extents = child->half_extents;
+	child_body->radius = child->radius;
+	child_body->half_height = child->half_height;
+	child_body->hull = child->hull;
+	child_body->position = pose_to_world(pose, child->pose.position);
+	child_body->orientation = mat3_mul(&pose->orientation, &child->pose.orientation);
+	invalidate_transform(child_body);
+}
+
+// Stand-in for a body moved to its pose t into the step, so it can be tested at t = 0 against
+// compound children. Only the shape and pose are set, which is all the pair tests read.
+void probe_body(Cube* const probe, const Cube* const cube, const float t) {
+	const Pose pose = probe_pose(cube, t);
+	*probe = (Cube){};
+	probe->index = cube->index;
+	probe->type = cube->type;
+	probe->shape = cube->shape;
+	probe->half_extents = cube->half_extents;
+	probe->radius = cube->radius;
+	probe->half_height = cube->half_height;
+	probe->hull = cube->hull;
+	probe->mesh = cube->mesh;
+	probe->heightfield = cube->heightfield;
+	probe->compound = cube->compound;
+	probe->position = pose.position;
+	probe->orientation = pose.orientation;
+	invalidate_transform(probe);
+}
+
+// Moves the points of a child manifold into the body space of the bodies the children belong
+// to. child_pose_a and child_pose_b place the children in their compounds, NULL when the body
+// is not a compound.
+void compound_manifold_remap(ContactManifold* const contact_manifold, Cube* const cube_a, const Pose* const child_pose_a, Cube* const cube_b, const Pose* const child_pose_b) {
+	for (int i = 0; i < contact_manifold->num_points; i++) {
+		if (child_pose_a) {
+			contact_manifold->local_points_a[i] = pose_to_world(child_pose_a, contact_manifold->local_points_a[i]);
+		}
+		if (child_pose_b) {
+			contact_manifold->local_points_b[i] = pose_to_world(child_pose_b, contact_manifold->local_points_b[i]);
+		}
+	}
+	contact_manifold->cube_a = cube_a;
+	contact_manifold->cube_b = cube_b;
+}
+
+enum { COMPOUND_MAX_MANIFOLDS = 64 };
+
+// Child manifolds of one pair of bodies, merged once all child pairs ran
+typedef struct {
+	ContactManifold manifolds[COMPOUND_MAX_MANIFOLDS];
+	int num_manifolds;
+} CompoundCollision;
+
+void compound_collision_add(CompoundCollision* const collision, const ContactManifold* const child_manifold) {
+	if (collision->num_manifolds >= COMPOUND_MAX_MANIFOLDS) {
+		SIM_STATS.manifold_overflows++;
+		return;
+	}
+	collision->manifolds[collision->num_manifolds++] = *child_manifold;
+}
+
+void compound_collision_test(CompoundCollision* const collision, Cube* const child_a, Cube* const cube_a, const Pose* const child_pose_a, Cube* const child_b, Cube* const cube_b, const Pose* const child_pose_b) {
+	SIM_STATS.compound_child_pairs++;
+
+	ContactManifold child_manifold = {};
+	if (collision_check_shapes(&child_manifold, child_a, child_b, 0)) {
+		compound_manifold_remap(&child_manifold, cube_a, child_pose_a, cube_b, child_pose_b);
+		compound_collision_add(collision, &child_manifold);
+	}
+}
+
+enum { COMPOUND_MAX_POINTS = 256 };
+
+// Offset of a body space point from the center of mass across the normal
+Vec3 contact_plane_offset(const Vec3 point, const Vec3 normal) {
+	return vec3_sub(point, vec3_scale(normal, vec3_dot(point, normal)));
+}
+
+// Index of the point closest to the reflection of another through the center of mass
+int opposite_contact_point(const Vec3* const points, const int num_points, const Vec3 normal, const int point) {
+	const Vec3 reflection = vec3_scale(contact_plane_offset(points[point], normal), -1);
+	int opposite = point;
+	float opposite_distance = FLT_MAX;
+	for (int i = 0; i < num_points; i++) {
+		const Vec3 offset = vec3_sub(contact_plane_offset(points[i], normal), reflection);
+		if (vec3_dot(offset, offset) < opposite_distance) {
+			opposite_distance = vec3_dot(offset, offset);
+			opposite = i;
+		}
+	}
+	return opposite;
+}
+
+// Indices of at most four points to stand in for all of them. The impulses of a manifold are
+// averaged over its points, so the kept points come in pairs on opposite sides of the center of
+// mass: otherwise a body resting evenly on many children is tipped over by whichever side kept
+// more points. The first pair starts from the point furthest out, the second from the point
+// furthest to either side of the line through the first pair.
+int reduce_contact_points(const Vec3* const points, const int num_points, const Vec3 normal, int* const kept) {
+	int first = 0;
+	float first_distance = -1;
+	for (int i = 0; i < num_points; i++) {
+		const Vec3 offset = contact_plane_offset(points[i], normal);
+		if (vec3_dot(offset, offset) > first_distance) {
+			first_distance = vec3_dot(offset, offset);
+			first = i;
+		}
+	}
+	const int second = opposite_contact_point(points, num_points, normal, first);
+
+	const Vec3 origin = points[first];
+	const Vec3 edge = vec3_sub(points[second], origin);
+	int third = first;
+	float third_area = 0;
+	for (int i = 0; i < num_points; i++) {
+		const float area = fabsf(vec3_dot(vec3_cross(edge, vec3_sub(points[i], origin)), normal));
+		if (area > third_area) {
+			third_area = area;
+			third = i;
+		}
+	}
+	const int fourth = opposite_contact_point(points, num_points, normal, third);
+
+	const int corners[4] = { first, second, third, fourth };
+	int num_kept = 0;
+	for (int i = 0; i < 4; i++) {
+		bool duplicate = false;
+		for (int k = 0; k < num_kept; k++) {
+			duplicate |= kept[k] == corners[i];
+		}
+		if (!duplicate) {
+			kept[num_kept++] = corners[i];
+		}
+	}
+
+	return num_kept;
+}
+
+// One manifold from the child manifolds, with the normal of the deepest contact. Several children
+// resting on something easily give more points than a manifold holds, so beyond four they are
+// reduced by reduce_contact_points.
+bool compound_collision_end(const CompoundCollision* const collision, const Pose* const pose_a, ContactManifold* const contact_manifold) {
+	if (collision->num_manifolds == 0) {
+		return false;
+	}
+
+	int deepest = 0;
+	float deepest_depth = FLT_MAX;
+	for (int i = 0; i < collision->num_manifolds; i++) {
+		const ContactManifold* const child_manifold = &collision->manifolds[i];
+		for (int j = 0; j < child_manifold->num_points; j++) {
+			if (child_manifold->depths[j] < deepest_depth) {
+				deepest_depth = child_manifold->depths[j];
+				deepest = i;
+			}
+		}
+	}
+
+	// The manifold has a single normal, children touching along another one are left out
+	const Vec3 normal = collision->manifolds[deepest].normal;
+	Vec3 local_points_a[COMPOUND_MAX_POINTS];
+	Vec3 local_points_b[COMPOUND_MAX_POINTS];
+	float depths[COMPOUND_MAX_POINTS];
+	int num_points = 0;
+
+	for (int i = 0; i < collision->num_manifolds; i++) {
+		const ContactManifold* const child_manifold = &collision->manifolds[i];
+		if (vec3_dot(child_manifold->normal, normal) < MANIFOLD_NORMAL_AGREEMENT) {
+			continue;
+		}
+
+		for (int j = 0; j < child_manifold->num_points && num_points < COMPOUND_MAX_POINTS; j++) {
+			local_points_a[num_points] = child_manifold->local_points_a[j];
+			local_points_b[num_points] = child_manifold->local_points_b[j];
+			depths[num_points] = child_manifold->depths[j];
+			num_points++;
+		}
+	}
+
+	int kept[MANIFOLD_POINTS];
+	int num_kept = 0;
+	if (num_points <= 4) {
+		for (int i = 0; i < num_points; i++) {
+			kept[num_kept++] = i;
+		}
+	} else {
+		num_kept = reduce_contact_points(local_points_a, num_points, rotate_to_local(&pose_a->orientation, normal), kept);
+	}
+
+	contact_manifold->num_points = num_kept;
+	for (int i = 0; i < num_kept; i++) {
+		contact_manifold->local_points_a[i] = local_points_a[kept[i]];
+		contact_manifold->local_points_b[i] = local_points_b[kept[i]];
+		contact_manifold->depths[i] = depths[kept[i]];
+	}
+	contact_manifold->normal = normal;
+	contact_manifold->cube_a = collision->manifolds[deepest].cube_a;
+	contact_manifold->cube_b = collision->manifolds[deepest].cube_b;
+
+	return true;
+}
+
+// Tests the children of a compound whose bounds overlap the other body. Against another
+// compound, each of those children is tested only with the other's children it overlaps.
+bool collision_check_compound(ContactManifold* const contact_manifold, Cube* const compound_body, Cube* const other, const float t) {
+	const CompoundShape* const compound = compound_body->compound;
+	const Pose pose_a = probe_pose(compound_body, t);
+
+	Cube other_probe;
+	probe_body(&other_probe, other, t);
+	const Pose pose_b = cube_pose(&other_probe);
+	const BoxGeometry* const other_geometry = cube_geometry(&other_probe);
+
+	Vec3 min, max;
+	bounds_to_local(&pose_a, other_geometry->aabb_min, other_geometry->aabb_max, &min, &max);
+	int children_a[COMPOUND_MAX_CHILDREN];
+	const int num_children_a = aabb_tree_query(&compound->tree, min, max, children_a, COMPOUND_MAX_CHILDREN);
+
+	CompoundCollision collision;
+	collision.num_manifolds = 0;
+
+	for (int k = 0; k < num_children_a; k++) {
+		const CompoundChild* const child = &compound->children[children_a[k]];
+		Cube child_body;
+		compound_child_body(&child_body, compound_body, child, &pose_a);
+
+		if (other->shape != SHAPE_COMPOUND) {
+			compound_collision_test(&collision, &child_body, compound_body, &child->pose, &other_probe, other, NULL);
+			continue;
+		}
+
+		const BoxGeometry* const child_geometry = cube_geometry(&child_body);
+		bounds_to_local(&pose_b, child_geometry->aabb_min, child_geometry->aabb_max, &min, &max);
+		int children_b[COMPOUND_MAX_CHILDREN];
+		const int num_children_b = aabb_tree_query(&other->compound->tree, min, max, children_b, COMPOUND_MAX_CHILDREN);
+
+		for (int n = 0; n < num_children_b; n++) {
+			const CompoundChild* const other_child = &other->compound->children[children_b[n]];
+			Cube other_child_body;
+			compound_child_body(&other_child_body, other, other_child, &pose_b);
+			compound_collision_test(&collision, &child_body, compound_body, &child->pose, &other_child_body, other, &other_child->pose);
+		}
+	}
+
+	return compound_collision_end(&collision, &pose_a, contact_manifold);
+}
+
+bool collision_check_floor_compound(ContactManifold* const contact_manifold, Cube* const cube, const float t) {
+	const CompoundShape* const compound = cube->compound;
+	const Pose pose = probe_pose(cube, t);
+
+	CompoundCollision collision;
+	collision.num_manifolds = 0;
+
+	for (int i = 0; i < compound->num_children; i++) {
+		const CompoundChild* const child = &compound->children[i];
+		Cube child_body;
+		compound_child_body(&child_body, cube, child, &pose);
+
+		ContactManifold child_manifold = {};
+		if (!collision_check_floor_shape(contact_manifold ? &child_manifold : NULL, &child_body, 0)) {
+			continue;
+		}
+
+		if (!contact_manifold) {
+			return true;
+		}
+
+		compound_manifold_remap(&child_manifold, cube, &child->pose, &GROUND, NULL);
+		compound_collision_add(&collision, &child_manifold);
+	}
+
+	return contact_manifold && compound_collision_end(&collision, &pose, contact_manifold);
+}
+
+bool collision_check_floor(ContactManifold* const contact_manifold, Cube* const cube, const float t) {
+	if (cube->shape == SHAPE_COMPOUND) {
+		return collision_check_floor_compound(contact_manifold, cube, t);
+	}
+	return collision_check_floor_shape(contact_manifold, cube, t);
+}
+
+// Compounds are split into their children here, everything else goes through the table
+bool collision_check_pair(ContactManifold* const contact_manifold, Cube* const cube_a, Cube* const cube_b, const float t) {
+	if (cube_a->shape == SHAPE_COMPOUND) {
+		return collision_check_compound(contact_manifold, cube_a, cube_b, t);
+	}
+	if (cube_b->shape == SHAPE_COMPOUND) {
+		return collision_check_swapped(collision_check_compound, contact_manifold, cube_a, cube_b, t);
+	}
+	return collision_check_shapes(contact_manifold, cube_a, cube_b, t);
+}
+
+// Effective inverse mass of a cube at a body space contact point along a world space normal
+float contact_inverse_mass(const Cube* const cube, const Vec3 local_point, const Vec3 normal) {
+	const Vec3 arm_cross_normal = vec3_cross(local_point, world_to_body(cube, normal));
+	return cube->inverse_mass + vec3_dot(arm_cross_normal, vec3_mul(cube->inverse_inertia, arm_cross_normal));
+}
+
+void calculate_impulses(const ContactManifold* const contact_manifold, float* const impulses) {
+	Cube* const cube_a = contact_manifold->cube_a;
+	Cube* const cube_b = contact_manifold->cube_b;
+
+	for (int i = 0; i < contact_manifold->num_points; i++) {
+		const Vec3 local_collision_point_a = contact_manifold->local_points_a[i];
+		const Vec3 local_collision_point_b = contact_manifold->local_points_b[i];
+
+		const Vec3 collision_normal = contact_manifold->normal;
+
+		// Static and kinematic bodies contribute nothing to the denominator
+		const Vec3 relative_velocity = vec3_sub(cube_a->velocity, cube_b->velocity);
+		const float denominator = contact_inverse_mass(cube_a, local_collision_point_a, collision_normal) + contact_inverse_mass(cube_b, local_collision_point_b, collision_normal);
+
+		if (denominator == 0) {
+			impulses[i] = 0;
+			continue;
+		}
+
+		const float numerator = vec3_dot(vec3_scale(relative_velocity, -(1 + COEFFICIENT_OF_RESTITUTION)), collision_normal);
+
+		float impulse = numerator / denominator;
+		/*
+		impulse = fmaxf(impulse, 0);
+		impulse *= 0.2f;
+		*/
+		impulses[i] = impulse;
+	}
+}
+
+// Angular velocity change from an impulse applied at a body space point, the angular velocity is in body space
+Vec3 angular_impulse_response(const Cube* const cube, const Vec3 local_point, const Vec3 impulse) {
+	return vec3_mul(cube->inverse_inertia, vec3_cross(local_point, world_to_body(cube, impulse)));
+}
+
+// Changes the velocities of a dynamic body at once, as an impulse at a world space point would
+void apply_impulse(Cube* const cube, const Vec3 impulse, const Vec3 point) {
+	if (cube->type != BODY_DYNAMIC) {
+		return;
+	}
+
+	const Vec3 local_point = world_to_body(cube, vec3_sub(point, cube->position));
+	cube->velocity = vec3_add(cube->velocity, vec3_scale(impulse, cube->inverse_mass));
+	cube->angular_velocity = vec3_add(cube->angular_velocity, angular_impulse_response(cube, local_point, impulse));
+	cube->state_stamp = BODY_STATE_CLOCK;
+	RESTING_CUBES[cube->index] = false;
+}
+
+// World space velocity of a body space point from the rotation alone
+Vec3 angular_point_velocity(const Cube* const cube, const Vec3 local_point) {
+	return body_to_world(cube, vec3_cross(cube->angular_velocity, local_point));
+}
+
+void apply_impulses(ContactManifold* const contact, const float* const impulses) {
+	Cube* const cube_a = contact->cube_a;
+	Cube* const cube_b = contact->cube_b;
+
+	Vec3 total_linear_impulse_a = {};
+	Vec3 total_angular_impulse_a = {};
+	Vec3 total_linear_impulse_b = {};
+	Vec3 total_angular_impulse_b = {};
+
+	for (int i = 0; i < contact->num_points; i++) {
+		const Vec3 normal_impulse_a = vec3_scale(contact->normal, impulses[i]);
+		const Vec3 normal_impulse_b = vec3_scale(contact->normal, -impulses[i]);
+
+		const Vec3 local_collision_point_a = contact->local_points_a[i];
+		const Vec3 local_collision_point_b = contact->local_points_b[i];
+
+		const Vec3 point_velocity_a = vec3_add(cube_a->velocity, angular_point_velocity(cube_a, local_collision_point_a));
+		const Vec3 point_velocity_b = vec3_add(cube_b->velocity, angular_point_velocity(cube_b, local_collision_point_b));
+		const Vec3 relative_point_velocity = vec3_sub(point_velocity_a, point_velocity_b);
+
+		const Vec3 tangential_velocity = vec3_sub(relative_point_velocity, vec3_scale(contact->normal, vec3_dot(relative_point_velocity, contact->normal)));
+
+		const float tangential_impulse_magnitude_max = LINEAR_FRICTION_COEFFICIENT * impulses[i];
+		const float tangential_impulse_magnitude = fmin(vec3_length(tangential_velocity), tangential_impulse_magnitude_max);
+		const Vec3 tangential_impulse_a = vec3_scale(vec3_normalize(tangential_velocity), -tangential_impulse_magnitude);
+		const Vec3 tangential_impulse_b = vec3_scale(vec3_normalize(tangential_velocity), tangential_impulse_magnitude);
+
+		// Sum impulses, static and kinematic bodies have zero inverse mass and inertia
+		total_linear_impulse_a = vec3_add(total_linear_impulse_a, vec3_scale(vec3_add(normal_impulse_a, tangential_impulse_a), cube_a->inverse_mass));
+		total_angular_impulse_a = vec3_add(total_angular_impulse_a, angular_impulse_response(cube_a, local_collision_point_a, normal_impulse_a));
+		total_linear_impulse_b = vec3_add(total_linear_impulse_b, vec3_scale(vec3_add(normal_impulse_b, tangential_impulse_b), cube_b->inverse_mass));
+		total_angular_impulse_b = vec3_add(total_angular_impulse_b, angular_impulse_response(cube_b, local_collision_point_b, normal_impulse_b));
+	}
+
+	if (cube_a->type == BODY_DYNAMIC) {
+		cube_a->velocity = vec3_add(cube_a->velocity, vec3_div(total_linear_impulse_a, contact->num_points));
+		cube_a->angular_velocity = vec3_add(cube_a->angular_velocity, vec3_div(total_angular_impulse_a, contact->num_points));
+	}
+
+	if (cube_b->type == BODY_DYNAMIC) {
+		cube_b->velocity = vec3_add(cube_b->velocity, vec3_div(total_linear_impulse_b, contact->num_points));
+		cube_b->angular_velocity = vec3_add(cube_b->angular_velocity, vec3_div(total_angular_impulse_b, contact->num_points));
+	}
+}
+
+// Bounds of a body over the whole step, from its start and extrapolated end pose
+void swept_bounds(Cube* const cube, Vec3* const min, Vec3* const max) {
+	const BoxGeometry* const start = cube_geometry(cube);
+	*min = start->aabb_min;
+	*max = start->aabb_max;
+
+	if (cube->type != BODY_STATIC) {
+		const Pose end_pose = cube_pose_at(cube, (float)DELTA_TIME);
+		BoxGeometry end;
+		box_geometry_from_pose(&end, &end_pose, cube->half_extents);
+
+		*min = new_vec3(fminf(min->x, end.aabb_min.x), fminf(min->y, end.aabb_min.y), fminf(min->z, end.aabb_min.z));
+		*max = new_vec3(fmaxf(max->x, end.aabb_max.x), fmaxf(max->y, end.aabb_max.y), fmaxf(max->z, end.aabb_max.z));
+	}
+
+	const Vec3 margin = { BROADPHASE_MARGIN, BROADPHASE_MARGIN, BROADPHASE_MARGIN };
+	*min = vec3_sub(*min, margin);
+	*max = vec3_add(*max, margin);
+}
+
+// Rebuilds the moving body tree every step and the static tree only when it changed,
+// storing each body's swept bounds for the queries
+void update_broadphase(Vec3* const bounds_min, Vec3* const bounds_max) {
+	AabbProxy proxies[MAX_CUBES];
+
+	if (STATIC_TREE_DIRTY) {
+		int num_static = 0;
+		for (int i = 0; i < MAX_CUBES; i++) {
+			if (ACTIVE_CUBES[i] && CUBES[i].type == BODY_STATIC) {
+				proxies[num_static].index = i;
+				swept_bounds(&CUBES[i], &proxies[num_static].min, &proxies[num_static].max);
+				num_static++;
+			}
+		}
+
+		aabb_tree_build(&STATIC_TREE, proxies, num_static);
+		STATIC_TREE_DIRTY = false;
+	}
+
+	int num_moving = 0;
+	for (int i = 0; i < MAX_CUBES; i++) {
+		if (!ACTIVE_CUBES[i] || CUBES[i].type == BODY_STATIC) {
+			continue;
+		}
+
+		swept_bounds(&CUBES[i], &bounds_min[i], &bounds_max[i]);
+		proxies[num_moving].index = i;
+		proxies[num_moving].min = bounds_min[i];
+		proxies[num_moving].max = bounds_max[i];
+		num_moving++;
+	}
+
+	aabb_tree_build(&MOVING_TREE, proxies, num_moving);
+	MOVING_TREE_DIRTY = false;
+}
+
+// After the bodies were replaced as a whole, as by snapshot_restore
+void broadphase_invalidate() {
+	STATIC_TREE_DIRTY = true;
+	MOVING_TREE_DIRTY = true;
+}
+
+void broadphase_refresh() {
+	if (MOVING_TREE_DIRTY || STATIC_TREE_DIRTY) {
+		Vec3 bounds_min[MAX_CUBES];
+		Vec3 bounds_max[MAX_CUBES];
+		update_broadphase(bounds_min, bounds_max);
+	}
+}
+
+// Bodies that need a narrowphase test against dynamic body index, in ascending index order.
+// Pairs with a lower dynamic index were already found when that body was processed, pairs
+// without a dynamic body never reach this point.
+int find_pair_candidates(const int index, const Vec3 bounds_min, const Vec3 bounds_max, int* const candidates) {
+	int found[MAX_CUBES];
+	int num_candidates = 0;
+
+	const int num_moving = aabb_tree_query(&MOVING_TREE, bounds_min, bounds_max, found, MAX_CUBES);
+	for (int k = 0; k < num_moving; k++) {
+		const int j = found[k];
+		if (j == index || cube_is_resting(j)) {
+			continue;
+		}
+		if (CUBES[j].type == BODY_DYNAMIC && j < index) {
+			continue;
+		}
+		candidates[num_candidates++] = j;
+	}
+
+	const int num_static = aabb_tree_query(&STATIC_TREE, bounds_min, bounds_max, found, MAX_CUBES - num_candidates);
+	for (int k = 0; k < num_static; k++) {
+		candidates[num_candidates++] = found[k];
+	}
+
+	// Tree order depends on the build, sort so the narrowphase runs in a stable order
+	for (int k = 1; k < num_candidates; k++) {
+		const int value = candidates[k];
+		int m = k - 1;
+		while (m >= 0 && candidates[m] > value) {
+			candidates[m + 1] = candidates[m];
+			m--;
+		}
+		candidates[m + 1] = value;
+	}
+
+	return num_candidates;
+}
+
+void physics_step() {
+	PROFILE_BEGIN(PROFILE_ZONE_PHYSICS_STEP);
+	const double step_start_time_ms = get_time_ms();
+	stats_begin_step();
+
+	// Bodies added or removed here only mark the trees, update_broadphase rebuilds them once
+	commands_flush();
+
+	// Collision detection
+	enum { MAX_MANIFOLDS = 256, MAX_TEMP_MANIFOLDS = 10 };
+	ContactManifold contact_manifolds[MAX_MANIFOLDS];
+	int num_manifolds = 0;
+
+	float times_of_impact[MAX_CUBES] = {}; // Store the earliest time of impact for each cube
+
+	PROFILE_BEGIN(PROFILE_ZONE_BROADPHASE);
+	Vec3 bounds_min[MAX_CUBES];
+	Vec3 bounds_max[MAX_CUBES];
+	update_broadphase(bounds_min, bounds_max);
+
+	for (int i = 0; i < MAX_CUBES; i++) {
+		if (!ACTIVE_CUBES[i]) {
+			continue;
+		}
+
+		SIM_STATS.active_bodies++;
+
+		// Only dynamic bodies respond to contacts, so only they start pair tests
+		if (CUBES[i].type != BODY_DYNAMIC) {
+			continue;
+		}
+
+		if (cube_is_resting(i)) {
+			SIM_STATS.sleeping_bodies++;
+			continue;
+		}
+
+		float earliest_time_of_impact = FLT_MAX;
+
+		Cube* const cube = &CUBES[i];
+		bool cube_collision;
+		int cube_collision_count = 0;
+		int cube_b_indices[MAX_TEMP_MANIFOLDS];
+
+		double t0 = 0;
+		double t1 = DELTA_TIME;
+		double t_mid = 0;
+
+		ContactManifold temp_manifolds[MAX_TEMP_MANIFOLDS];
+		int temp_manifold_count = 0;
+
+		int candidates[MAX_CUBES];
+		const int num_candidates = find_pair_candidates(i, bounds_min[i], bounds_max[i], candidates);
+		SIM_STATS.candidate_pairs += num_candidates;
+
+		PROFILE_BEGIN(PROFILE_ZONE_BISECTION);
+		while (t1 - t0 > COLLISION_TIME_TOLERANCE) {
+			cube_collision = false;
+			temp_manifold_count = 0;
+			cube_collision_count = 0;
+			t_mid = (t0 + t1) / 2;
+			SIM_STATS.bisection_iterations++;
+
+			bool collision = false;
+
+			ContactManifold floor_manifold = {};
+			PROFILE_BEGIN(PROFILE_ZONE_FLOOR);
+			const bool floor_collision = collision_check_floor(&floor_manifold, cube, (float)t_mid);
+			PROFILE_END(PROFILE_ZONE_FLOOR);
+			if (floor_collision) {
+				collision = true;
+				temp_manifolds[temp_manifold_count++] = floor_manifold;
+			}
+
+			for (int k = 0; k < num_candidates; k++) {
+				const int j = candidates[k];
+
+				ContactManifold cube_manifold = {};
+				PROFILE_BEGIN(PROFILE_ZONE_SAT);
+				const bool cubes_collision = collision_check_pair(&cube_manifold, cube, &CUBES[j], (float)t_mid);
+				PROFILE_END(PROFILE_ZONE_SAT);
+				if (cubes_collision) {
+					collision = true;
+
+					if (temp_manifold_count >= MAX_TEMP_MANIFOLDS) {
+						SIM_STATS.manifold_overflows++;
+						continue;
+					}
+
+					temp_manifolds[temp_manifold_count++] = cube_manifold;
+					cube_collision = true;
+					cube_b_indices[cube_collision_count++] = j;
+				}
+			}
+
+			if (collision) {
+				t1 = t_mid;
+			} else {
+				t0 = t_mid;
+			}
+		}
+		PROFILE_END(PROFILE_ZONE_BISECTION);
+
+		for (int j = 0; j < temp_manifold_count; j++) {
+			if (num_manifolds >= MAX_MANIFOLDS) {
+				SIM_STATS.manifold_overflows++;
+				break;
+			}
+
+			contact_manifolds[num_manifolds++] = temp_manifolds[j];
+			SIM_STATS.contact_points += temp_manifolds[j].num_points;
+		}
+
+		if (temp_manifold_count > 0 && earliest_time_of_impact > t_mid) {
+			earliest_time_of_impact = t_mid;
+			times_of_impact[i] = t_mid;
+			if (cube_collision) {
+				for (int j = 0; j < cube_collision_count; j++) {
+					// Kinematic bodies follow their scripted motion
+					if (CUBES[cube_b_indices[j]].type == BODY_DYNAMIC) {
+						times_of_impact[cube_b_indices[j]] = t_mid;
+					}
+				}
+			}
+		}
+	}
+	PROFILE_END(PROFILE_ZONE_BROADPHASE);
+
+	SIM_STATS.manifolds = num_manifolds;
+
+	// Apply post-bisection integration
+	PROFILE_BEGIN(PROFILE_ZONE_INTEGRATION);
+	for (int i = 0; i < MAX_CUBES; i++) {
+		if (ACTIVE_CUBES[i]) {
+			integrate_cube(&CUBES[i], times_of_impact[i]);
+		}
+	}
+	PROFILE_END(PROFILE_ZONE_INTEGRATION);
+
+	for (int manifold_index = 0; manifold_index < num_manifolds; manifold_index++) {
+		ContactManifold* const contact = &contact_manifolds[manifold_index];
+		memset(contact->accumulated_impulses, 0, MANIFOLD_POINTS * sizeof(float));
+	}
+
+	// Normal impulse each manifold received, apply_impulses spreads it over the points
+	float manifold_impulses[MAX_MANIFOLDS] = {};
+
+	PROFILE_BEGIN(PROFILE_ZONE_SOLVER);
+	for (int i = 0; i < 20; i++) {
+		for (int manifold_index = 0; manifold_index < num_manifolds; manifold_index++) {
+			ContactManifold* const contact = &contact_manifolds[manifold_index];
+
+			float new_impulses[MANIFOLD_POINTS] = {};
+			float delta_impulses[MANIFOLD_POINTS] = {};
+
+			calculate_impulses(contact, new_impulses);
+			for (int j = 0; j < contact->num_points; j++) {
+				const float new_accumulated_impulse = contact->accumulated_impulses[j] + new_impulses[j];
+
+				delta_impulses[j] = fmaxf(new_accumulated_impulse - contact->accumulated_impulses[j], 0);
+				contact->accumulated_impulses[j] = new_accumulated_impulse;
+				manifold_impulses[manifold_index] += delta_impulses[j] / contact->num_points;
+			}
+
+			apply_impulses(contact, delta_impulses);
+		}
+
+		SIM_STATS.solver_iterations++;
+	}
+	PROFILE_END(PROFILE_ZONE_SOLVER);
+
+	for (int manifold_index = 0; manifold_index < num_manifolds; manifold_index++) {
+		contact_events_add(&contact_manifolds[manifold_index], manifold_impulses[manifold_index]);
+	}
+	contact_events_end_step();
+
+	// Penetration correction
+	PROFILE_BEGIN(PROFILE_ZONE_PENETRATION_CORRECTION);
+	for (int manifold_index = 0; manifold_index < num_manifolds; manifold_index++) {
+		const ContactManifold* const contact_manifold = &contact_manifolds[manifold_index];
+		Cube* const cube_a = contact_manifold->cube_a;
+		Cube* const cube_b = contact_manifold->cube_b;
+
+		float max_depth = FLT_MIN;
+		for (int i = 0; i < contact_manifold->num_points; i++) {
+			if (fabsf(contact_manifold->depths[i]) > fabsf(max_depth)) {
+				max_depth = contact_manifold->depths[i];
+			}
+		}
+
+		// Split the correction by inverse mass, equal masses move half each and
+		// static or kinematic bodies do not move at all
+		const float total_inverse_mass = cube_a->inverse_mass + cube_b->inverse_mass;
+		if (total_inverse_mass == 0) {
+			continue;
+		}
+
+		if (cube_a->type == BODY_DYNAMIC) {
+			const float share_a = cube_a->inverse_mass / total_inverse_mass;
+			cube_a->position = vec3_add(cube_a->position, vec3_scale(contact_manifold->normal, -max_depth * share_a));
+			invalidate_transform(cube_a);
+		}
+
+		if (cube_b->type == BODY_DYNAMIC) {
+			const float share_b = cube_b->inverse_mass / total_inverse_mass;
+			cube_b->position = vec3_add(cube_b->position, vec3_scale(contact_manifold->normal, max_depth * share_b));
+			invalidate_transform(cube_b);
+		}
+	}
+	PROFILE_END(PROFILE_ZONE_PENETRATION_CORRECTION);
+
+	// Integrate cubes
+	PROFILE_BEGIN(PROFILE_ZONE_INTEGRATION);
+	for (int i = 0; i < MAX_CUBES; i++) {
+		if (!ACTIVE_CUBES[i]) {
+			continue;
+		}
+
+		if (RESTING_CUBES[i]) {
+			continue;
+		}
+
+		integrate_cube(&CUBES[i], (float)DELTA_TIME);
+	}
+	PROFILE_END(PROFILE_ZONE_INTEGRATION);
+
+	body_state_end_step();
+
+	SIM_STATS.step_time_ms = get_time_ms() - step_start_time_ms;
+	stats_log_step();
+
+	PROFILE_END(PROFILE_ZONE_PHYSICS_STEP);
+	PROFILE_STEP_END();
+}
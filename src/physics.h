@@ -0,0 +1,195 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "matrix.h"
+#include "broadphase.h"
+#include "convex_hull.h"
+#include "mesh.h"
+#include "heightfield.h"
+
+// Position and orientation of a body, enough to place it in the world without building matrices
+typedef struct {
+	Vec3 position;
+	Mat3 orientation;
+} Pose;
+
+// World space geometry of a box, corners stored as structure of arrays
+typedef struct {
+	float corners_x[8];
+	float corners_y[8];
+	float corners_z[8];
+	Vec3 face_normals[3];
+	Vec3 aabb_min;
+	Vec3 aabb_max;
+} BoxGeometry;
+
+typedef enum {
+	BODY_DYNAMIC,
+	BODY_STATIC, // Never moves and is never integrated
+	BODY_KINEMATIC // Moves with its scripted velocity and angular velocity, infinite mass
+} BodyType;
+
+typedef enum {
+	SHAPE_BOX,
+	SHAPE_SPHERE,
+	SHAPE_CAPSULE, // Segment along the body y axis swept by radius
+	SHAPE_HULL, // Convex hull, see convex_hull.h
+	SHAPE_MESH, // Static triangle mesh, see mesh.h
+	SHAPE_HEIGHTFIELD, // Static terrain grid, see heightfield.h
+	SHAPE_COMPOUND, // Rigid group of the convex shapes above, see CompoundShape
+	SHAPE_COUNT
+} ShapeType;
+
+// Part of a compound, placed by a pose in the compound's body space
+typedef struct {
+	ShapeType shape; // Box, sphere, capsule or hull
+	Pose pose;
+	Vec3 half_extents; // Set for boxes, compound_shape_build fills it in for the other shapes
+	float radius; // Spheres and capsules
+	float half_height; // Capsules
+	const ConvexHull* hull; // Owned by the caller, must outlive the compound
+	float mass;
+} CompoundChild;
+
+enum { COMPOUND_MAX_CHILDREN = 64 };
+
+// Built once by compound_shape_build and shared by every body using it
+typedef struct {
+	CompoundChild children[COMPOUND_MAX_CHILDREN];
+	int num_children;
+	AabbTree tree; // Body space bounds of the children, proxy indices are child indices
+
+	// The children are moved so the body origin is their center of mass, this is how far
+	Vec3 center_of_mass;
+	float mass;
+	Vec3 inertia; // Diagonal about the center of mass, products of inertia are dropped
+	Vec3 half_extents;
+} CompoundShape;
+
+typedef struct {
+	int index;
+	BodyType type;
+	ShapeType shape;
+
+	Vec3 half_extents; // Body space bounds of the shape, the box itself for boxes
+	float radius; // Spheres and capsules
+	float half_height; // Half length of a capsule's segment
+	// Owned by the caller, must outlive the body
+	const ConvexHull* hull;
+	const TriangleMesh* mesh;
+	const Heightfield* heightfield;
+	const CompoundShape* compound;
+	Mat3 orientation;
+	Vec3 position;
+
+	// Static and kinematic bodies have an inverse mass and inertia of 0
+	float mass;
+	float inverse_mass;
+	Vec3 inverse_inertia; // Diagonal of the inverse inertia tensor in body space
+
+	// Rebuilt lazily by cube_transform/cube_geometry after the pose changed,
+	// read them through those functions rather than directly
+	Mat4 transform;
+	Mat4 inverse_transform;
+	BoxGeometry geometry;
+	bool transform_dirty;
+	bool geometry_dirty;
+
+	Vec3 velocity;
+	Vec3 angular_velocity;
+	Vec3 torque;
+
+	uint32_t state_stamp; // BODY_STATE_CLOCK when the body last moved or was pushed, see body_state.h
+} Cube;
+
+typedef struct {
+	// TODO: The cube pointer could be replaced by the cube's index
+	Cube* cube;
+	Vec3 point;
+	Vec3 normal;
+	float penetration_depth;
+} Contact;
+
+enum { MANIFOLD_POINTS = 16 };
+
+typedef struct {
+	// Collision data
+	int num_points;
+	Vec3 normal;
+	Cube* cube_a;
+	Cube* cube_b;
+	// Contact points in body space of each cube
+	Vec3 local_points_a[MANIFOLD_POINTS];
+	Vec3 local_points_b[MANIFOLD_POINTS];
+	float depths[MANIFOLD_POINTS];
+
+	// Impulses
+	float accumulated_impulses[MANIFOLD_POINTS];
+} ContactManifold;
+
+enum { MAX_CUBES = 256 };
+extern Cube CUBES[MAX_CUBES];
+extern bool ACTIVE_CUBES[MAX_CUBES];
+extern bool RESTING_CUBES[MAX_CUBES];
+
+// Static body standing in for the floor plane at y = 0, which every body collides with
+extern Cube GROUND;
+
+// Broadphase trees over the swept bounds of static and of moving bodies, proxy indices are cube indices
+extern AabbTree STATIC_TREE;
+extern AabbTree MOVING_TREE;
+
+// Shape passed to body_support
+typedef struct {
+	const Cube* cube;
+	int hint; // Hull vertex the support search starts from
+} SupportContext;
+
+extern double DELTA_TIME;
+
+// Debug buffers filled by the narrowphase and drawn by the renderer
+enum { COLLISION_POINT_BUFFER_SIZE = 5 };
+extern Vec3 COLLISION_POINT_BUFFER[COLLISION_POINT_BUFFER_SIZE];
+
+enum { COLLISION_NORMAL_BUFFER_SIZE = 1 };
+extern Vec3 COLLISION_NORMAL_BUFFER[COLLISION_NORMAL_BUFFER_SIZE][2];
+extern Vec3 COLLISION_EDGES_BUFFER[COLLISION_NORMAL_BUFFER_SIZE][4];
+
+void physics_reset();
+Cube* add_cube(const Vec3 position, const Mat3 orientation);
+Cube* add_box(const Vec3 position, const Mat3 orientation, const Vec3 half_extents, const float mass);
+Cube* add_static_box(const Vec3 position, const Mat3 orientation, const Vec3 half_extents);
+Cube* add_kinematic_box(const Vec3 position, const Mat3 orientation, const Vec3 half_extents);
+Cube* add_sphere(const Vec3 position, const float radius, const float mass);
+Cube* add_capsule(const Vec3 position, const Mat3 orientation, const float radius, const float half_height, const float mass);
+Cube* add_hull(const Vec3 position, const Mat3 orientation, const ConvexHull* const hull, const float mass);
+Cube* add_mesh(const Vec3 position, const Mat3 orientation, const TriangleMesh* const mesh);
+Cube* add_heightfield(const Vec3 position, const Mat3 orientation, const Heightfield* const heightfield);
+bool compound_shape_build(CompoundShape* const compound, const CompoundChild* const children, const int num_children);
+Cube* add_compound(const Vec3 position, const Mat3 orientation, const CompoundShape* const compound);
+void set_static_pose(Cube* const cube, const Vec3 position, const Mat3 orientation);
+void remove_body(Cube* const cube);
+void apply_impulse(Cube* const cube, const Vec3 impulse, const Vec3 point);
+void update_transform(Cube* const cube);
+void invalidate_transform(Cube* const cube);
+const Mat4* cube_transform(Cube* const cube);
+const Mat4* cube_inverse_transform(Cube* const cube);
+const BoxGeometry* cube_geometry(Cube* const cube);
+Pose cube_pose(const Cube* const cube);
+Vec3 pose_to_world(const Pose* const pose, const Vec3 local_point);
+Vec3 rotate_to_local(const Mat3* const orientation, const Vec3 direction);
+Pose cube_pose_at(const Cube* const cube, const float t);
+void physics_step();
+float physics_total_energy();
+
+// Rebuilds the broadphase trees if bodies were added or moved since the last step, so queries
+// between steps see the current poses
+void broadphase_refresh();
+void broadphase_invalidate();
+
+// Shape helpers shared with the queries
+Vec3 body_support(void* const shape, const Vec3 direction);
+Vec3 triangle_support(void* const shape, const Vec3 direction);
+void bounds_to_local(const Pose* const pose, const Vec3 min, const Vec3 max, Vec3* const local_min, Vec3* const local_max);
+void compound_child_body(Cube* const child_body, const Cube* const compound_body, const CompoundChild* const child, const Pose* const pose);
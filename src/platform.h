@@ -12,6 +12,8 @@ typedef struct {
 	bool slowmo_3x;
 	bool slowmo_4x;
 	bool slowmo_5x;
+	bool dump_profile;
+	bool toggle_stats_log;
 
 	bool mouse_left;
 	Vec2 mouse_pos;
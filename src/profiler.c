@@ -0,0 +1,201 @@
+#include "profiler.h"
+#include "win32_time.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { PROFILE_MAX_THREADS = 64 };
+
+THREAD_LOCAL ProfileRing* PROFILE_RING = NULL;
+// Set on threads past PROFILE_MAX_THREADS, or when their ring could not be allocated
+THREAD_LOCAL bool PROFILE_THREAD_SKIPPED = false;
+
+ProfileRing* PROFILE_RINGS[PROFILE_MAX_THREADS] = {};
+volatile long NUM_PROFILE_RINGS = 0;
+
+int PROFILE_SUMMARY_INTERVAL = 600;
+uint64_t PROFILE_STEP_COUNT = 0;
+
+double PROFILE_TICKS_PER_MS = 0;
+uint64_t PROFILE_EPOCH = 0;
+
+static const char* const PROFILE_ZONE_NAMES[PROFILE_ZONE_COUNT] = {
+	"physics_step",
+	"broadphase",
+	"bisection",
+	"floor",
+	"sat",
+	"solver",
+	"penetration_correction",
+	"integration",
+	"draw"
+};
+
+// Used when rdtsc is not available
+uint64_t profiler_timestamp_fallback() {
+	return (uint64_t)(get_time_ms() * 1000000.0);
+}
+
+ProfileRing* profiler_register_thread() {
+	if (PROFILE_THREAD_SKIPPED) {
+		return NULL;
+	}
+
+	const long index = ATOMIC_ADD(&NUM_PROFILE_RINGS, 1);
+	ProfileRing* const ring = index < PROFILE_MAX_THREADS ? (ProfileRing*)calloc(1, sizeof(ProfileRing)) : NULL;
+	if (!ring) {
+		printf("Profiler: no ring for thread %ld, only the first %d threads are recorded\n", index, PROFILE_MAX_THREADS);
+		PROFILE_THREAD_SKIPPED = true;
+		return NULL;
+	}
+
+	ring->thread_index = (int)index;
+	PROFILE_RINGS[index] = ring;
+	PROFILE_RING = ring;
+
+	if (PROFILE_EPOCH == 0) {
+		PROFILE_EPOCH = profiler_timestamp();
+	}
+
+	return ring;
+}
+
+// Measures the timestamp frequency against the wall clock the first time it is needed
+double profiler_ticks_per_ms() {
+	if (PROFILE_TICKS_PER_MS > 0) {
+		return PROFILE_TICKS_PER_MS;
+	}
+
+#ifdef PROFILE_USE_RDTSC
+	const double start_ms = get_time_ms();
+	const uint64_t start_ticks = profiler_timestamp();
+	double now_ms;
+	do {
+		now_ms = get_time_ms();
+	} while (now_ms - start_ms < 10);
+	PROFILE_TICKS_PER_MS = (double)(profiler_timestamp() - start_ticks) / (now_ms - start_ms);
+#else
+	PROFILE_TICKS_PER_MS = 1000000.0;
+#endif
+
+	return PROFILE_TICKS_PER_MS;
+}
+
+const char* profiler_zone_name(const ProfileZone zone) {
+	return PROFILE_ZONE_NAMES[zone];
+}
+
+void profiler_set_summary_interval(const int steps) {
+	PROFILE_SUMMARY_INTERVAL = steps;
+}
+
+ProfileZoneStats profiler_get_zone_stats(const ProfileZone zone) {
+	const double ticks_per_ms = profiler_ticks_per_ms();
+
+	ProfileZoneStats stats = {};
+	uint64_t max_ticks = 0;
+	uint64_t total_ticks = 0;
+
+	for (int i = 0; i < NUM_PROFILE_RINGS && i < PROFILE_MAX_THREADS; i++) {
+		const ProfileRing* const ring = PROFILE_RINGS[i];
+		if (!ring) {
+			continue;
+		}
+
+		stats.count += ring->zone_counts[zone];
+		total_ticks += ring->zone_ticks[zone];
+		if (ring->zone_max_ticks[zone] > max_ticks) {
+			max_ticks = ring->zone_max_ticks[zone];
+		}
+	}
+
+	stats.total_ms = total_ticks / ticks_per_ms;
+	stats.max_ms = max_ticks / ticks_per_ms;
+	return stats;
+}
+
+void profiler_print_summary() {
+	const double step_count = PROFILE_STEP_COUNT > 0 ? (double)PROFILE_STEP_COUNT : 1;
+
+	printf("%-24s %10s %12s %12s %12s\n", "zone", "calls", "total ms", "ms/step", "max ms");
+	for (int zone = 0; zone < PROFILE_ZONE_COUNT; zone++) {
+		const ProfileZoneStats stats = profiler_get_zone_stats((ProfileZone)zone);
+		if (stats.count == 0) {
+			continue;
+		}
+
+		printf("%-24s %10llu %12.3f %12.4f %12.4f\n",
+			PROFILE_ZONE_NAMES[zone],
+			(unsigned long long)stats.count,
+			stats.total_ms,
+			stats.total_ms / step_count,
+			stats.max_ms);
+	}
+}
+
+// Clears the summary accumulators, the event rings are left intact for trace dumps
+void profiler_reset() {
+	for (int i = 0; i < NUM_PROFILE_RINGS && i < PROFILE_MAX_THREADS; i++) {
+		ProfileRing* const ring = PROFILE_RINGS[i];
+		if (!ring) {
+			continue;
+		}
+
+		memset(ring->zone_counts, 0, sizeof(ring->zone_counts));
+		memset(ring->zone_ticks, 0, sizeof(ring->zone_ticks));
+		memset(ring->zone_max_ticks, 0, sizeof(ring->zone_max_ticks));
+	}
+
+	PROFILE_STEP_COUNT = 0;
+}
+
+void profiler_step_end() {
+	PROFILE_STEP_COUNT++;
+
+	if (PROFILE_SUMMARY_INTERVAL > 0 && PROFILE_STEP_COUNT % PROFILE_SUMMARY_INTERVAL == 0) {
+		printf("Profile summary over %llu steps\n", (unsigned long long)PROFILE_STEP_COUNT);
+		profiler_print_summary();
+		profiler_reset();
+	}
+}
+
+// Writes the recorded events in the Chrome trace event format (chrome://tracing, Perfetto)
+bool profiler_write_chrome_trace(const char* const path) {
+	FILE* const file = fopen(path, "wb");
+	if (!file) {
+		printf("Failed to open profile trace file\n");
+		return false;
+	}
+
+	const double ticks_per_us = profiler_ticks_per_ms() / 1000.0;
+
+	fprintf(file, "{\"traceEvents\":[\n");
+
+	bool first = true;
+	for (int i = 0; i < NUM_PROFILE_RINGS && i < PROFILE_MAX_THREADS; i++) {
+		const ProfileRing* const ring = PROFILE_RINGS[i];
+		if (!ring) {
+			continue;
+		}
+
+		const uint64_t num_events = ring->num_events;
+		const uint64_t first_event = num_events > PROFILE_RING_SIZE ? num_events - PROFILE_RING_SIZE : 0;
+
+		for (uint64_t event_index = first_event; event_index < num_events; event_index++) {
+			const ProfileEvent* const event = &ring->events[event_index & (PROFILE_RING_SIZE - 1)];
+
+			fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				first ? "" : ",\n",
+				PROFILE_ZONE_NAMES[event->zone],
+				ring->thread_index,
+				(double)(event->start - PROFILE_EPOCH) / ticks_per_us,
+				(double)(event->end - event->start) / ticks_per_us);
+			first = false;
+		}
+	}
+
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	fclose(file);
+
+	return true;
+}
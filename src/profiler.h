@@ -0,0 +1,132 @@
+#pragma once
+
+#include "atomics.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Timing zones for the hot paths. Zones are recorded into a per-thread ring buffer
+// when KINESIS_PROFILE is defined, otherwise PROFILE_BEGIN/PROFILE_END compile to nothing.
+typedef enum {
+	PROFILE_ZONE_PHYSICS_STEP,
+	PROFILE_ZONE_BROADPHASE,
+	PROFILE_ZONE_BISECTION,
+	PROFILE_ZONE_FLOOR,
+	PROFILE_ZONE_SAT,
+	PROFILE_ZONE_SOLVER,
+	PROFILE_ZONE_PENETRATION_CORRECTION,
+	PROFILE_ZONE_INTEGRATION,
+	PROFILE_ZONE_DRAW,
+	PROFILE_ZONE_COUNT
+} ProfileZone;
+
+typedef struct {
+	uint64_t count;
+	double total_ms;
+	double max_ms;
+} ProfileZoneStats;
+
+enum { PROFILE_RING_SIZE = 1 << 16 }; // Must be a power of two
+enum { PROFILE_MAX_DEPTH = 32 };
+
+typedef struct {
+	uint64_t start;
+	uint64_t end;
+	uint16_t zone;
+	uint16_t depth;
+} ProfileEvent;
+
+typedef struct {
+	int thread_index;
+
+	ProfileEvent events[PROFILE_RING_SIZE];
+	uint64_t num_events; // Total events written, the ring holds the last PROFILE_RING_SIZE
+
+	uint64_t stack[PROFILE_MAX_DEPTH];
+	int depth;
+
+	// Accumulated since the last summary
+	uint64_t zone_counts[PROFILE_ZONE_COUNT];
+	uint64_t zone_ticks[PROFILE_ZONE_COUNT];
+	uint64_t zone_max_ticks[PROFILE_ZONE_COUNT];
+} ProfileRing;
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define PROFILE_USE_RDTSC 1
+#endif
+
+extern THREAD_LOCAL ProfileRing* PROFILE_RING;
+
+// Returns NULL when the thread gets no ring, its zones are then not recorded
+ProfileRing* profiler_register_thread();
+uint64_t profiler_timestamp_fallback();
+
+static inline uint64_t profiler_timestamp() {
+#ifdef PROFILE_USE_RDTSC
+	return __rdtsc();
+#else
+	return profiler_timestamp_fallback();
+#endif
+}
+
+static inline void profiler_begin(const ProfileZone zone) {
+	ProfileRing* ring = PROFILE_RING;
+	if (!ring) {
+		ring = profiler_register_thread();
+		if (!ring) {
+			return;
+		}
+	}
+
+	(void)zone;
+	ring->stack[ring->depth++ & (PROFILE_MAX_DEPTH - 1)] = profiler_timestamp();
+}
+
+static inline void profiler_end(const ProfileZone zone) {
+	const uint64_t end = profiler_timestamp();
+	ProfileRing* const ring = PROFILE_RING;
+	if (!ring) {
+		return;
+	}
+
+	const int depth = --ring->depth;
+	const uint64_t start = ring->stack[depth & (PROFILE_MAX_DEPTH - 1)];
+	const uint64_t ticks = end - start;
+
+	ProfileEvent* const event = &ring->events[ring->num_events++ & (PROFILE_RING_SIZE - 1)];
+	event->start = start;
+	event->end = end;
+	event->zone = (uint16_t)zone;
+	event->depth = (uint16_t)depth;
+
+	ring->zone_counts[zone]++;
+	ring->zone_ticks[zone] += ticks;
+	if (ticks > ring->zone_max_ticks[zone]) {
+		ring->zone_max_ticks[zone] = ticks;
+	}
+}
+
+#ifdef KINESIS_PROFILE
+#define PROFILE_BEGIN(zone) profiler_begin(zone)
+#define PROFILE_END(zone) profiler_end(zone)
+#define PROFILE_STEP_END() profiler_step_end()
+#else
+#define PROFILE_BEGIN(zone) ((void)0)
+#define PROFILE_END(zone) ((void)0)
+#define PROFILE_STEP_END() ((void)0)
+#endif
+
+const char* profiler_zone_name(const ProfileZone zone);
+
+// Call once per physics step, prints the summary table every PROFILE_SUMMARY_INTERVAL steps
+void profiler_step_end();
+void profiler_set_summary_interval(const int steps);
+
+ProfileZoneStats profiler_get_zone_stats(const ProfileZone zone);
+void profiler_print_summary();
+void profiler_reset();
+bool profiler_write_chrome_trace(const char* const path);
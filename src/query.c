@@ -0,0 +1,838 @@
+#include "query.h"
+#include "atomics.h"
+#include "gjk.h"
+#include "jobs.h"
+#include "math_ops.h"
+#include "math_simd.h"
+#include "stats.h"
+#include <float.h>
+#include <math.h>
+
+// Conservative advancement stops once the cast shape is this close, or after this many steps
+static const float CAST_TOLERANCE = 0.001f;
+enum { CAST_MAX_ITERATIONS = 32 };
+
+// Overlap queries a job thread takes at a time
+enum { OVERLAP_BATCH_SIZE = 32 };
+
+typedef enum {
+	CAST_RAY,
+	CAST_SPHERE,
+	CAST_BOX
+} CastType;
+
+typedef struct {
+	CastType type;
+	Vec3 origin;
+	Vec3 direction; // Normalized
+	Mat3 orientation; // Boxes, identity otherwise
+	Vec3 half_extents; // Boxes, zero otherwise
+	float radius; // Spheres, zero otherwise
+	Vec3 inflate; // Half size of the bounds of the cast shape
+	int* gjk_iterations; // Counter the GJK iterations of the cast go to, SIM_STATS unless on a job thread
+} Cast;
+
+Cast cast_make(const CastType type, const Vec3 origin, const Mat3 orientation, const Vec3 half_extents, const float radius, const Vec3 direction) {
+	const float (*const m)[3] = orientation.m;
+	const Cast cast = {
+		.type = type,
+		.origin = origin,
+		.direction = vec3_normalize(direction),
+		.orientation = orientation,
+		.half_extents = half_extents,
+		.radius = radius,
+		.inflate = {
+			fabsf(m[0][0]) * half_extents.x + fabsf(m[0][1]) * half_extents.y + fabsf(m[0][2]) * half_extents.z + radius,
+			fabsf(m[1][0]) * half_extents.x + fabsf(m[1][1]) * half_extents.y + fabsf(m[1][2]) * half_extents.z + radius,
+			fabsf(m[2][0]) * half_extents.x + fabsf(m[2][1]) * half_extents.y + fabsf(m[2][2]) * half_extents.z + radius
+		},
+		.gjk_iterations = &SIM_STATS.gjk_iterations
+	};
+	return cast;
+}
+
+// The cast moved into the body space of a pose
+Cast cast_to_local(const Cast* const cast, const Pose* const pose) {
+	const Mat3 inverse_orientation = mat3_inverse(&pose->orientation);
+	Cast local = *cast;
+	local.origin = rotate_to_local(&pose->orientation, vec3_sub(cast->origin, pose->position));
+	local.direction = rotate_to_local(&pose->orientation, cast->direction);
+	local.orientation = mat3_mul(&inverse_orientation, &cast->orientation);
+
+	Vec3 local_min;
+	Vec3 local_max;
+	bounds_to_local(pose, vec3_sub(cast->origin, cast->inflate), vec3_add(cast->origin, cast->inflate), &local_min, &local_max);
+	local.inflate = vec3_scale(vec3_sub(local_max, local_min), 0.5f);
+	return local;
+}
+
+// A hit found in the body space of a pose, moved to world space
+void hit_to_world(QueryHit* const hit, const Pose* const pose) {
+	hit->point = pose_to_world(pose, hit->point);
+	hit->normal = vec3_mul_mat3(hit->normal, &pose->orientation);
+}
+
+void hit_set(QueryHit* const hit, Cube* const cube, const float distance, const Vec3 point, const Vec3 normal) {
+	hit->cube = cube;
+	hit->distance = distance;
+	hit->point = point;
+	hit->normal = normal;
+}
+
+// Support of the cast shape without its radius: a point for rays and spheres, the box for boxes
+Vec3 cast_support(void* const shape, const Vec3 direction) {
+	const Vec3* const half_extents = shape;
+	return new_vec3(
+		direction.x < 0 ? -half_extents->x : half_extents->x,
+		direction.y < 0 ? -half_extents->y : half_extents->y,
+		direction.z < 0 ? -half_extents->z : half_extents->z);
+}
+
+// Conservative advancement: the cast shape moves along the direction by its GJK distance to the
+// target over the speed it closes in at, which never overshoots, until it is within tolerance.
+bool convex_cast(const Cast* const cast, Cube* const cube, const ConvexProxy* const target, const float max_distance, QueryHit* const hit) {
+	Vec3 half_extents = cast->half_extents;
+	ConvexProxy caster = { cast_support, &half_extents, { cast->origin, cast->orientation } };
+	GjkSimplex simplex = {};
+	Vec3 normal = vec3_scale(cast->direction, -1);
+	float t = 0;
+
+	for (int i = 0; i < CAST_MAX_ITERATIONS; i++) {
+		caster.pose.position = vec3_add(cast->origin, vec3_scale(cast->direction, t));
+		const GjkResult result = gjk_distance(&caster, target, &simplex, cast->gjk_iterations);
+
+		// Overlapping from the start, or touching closer than GJK resolves
+		if (result.intersecting) {
+			hit_set(hit, cube, t, caster.pose.position, normal);
+			return true;
+		}
+
+		normal = vec3_scale(vec3_sub(result.point_a, result.point_b), 1 / result.distance);
+		const float gap = result.distance - cast->radius;
+		if (gap <= CAST_TOLERANCE) {
+			hit_set(hit, cube, t, result.point_b, normal);
+			return true;
+		}
+
+		const float closing_speed = -vec3_dot(cast->direction, normal);
+		if (closing_speed <= 0) {
+			return false;
+		}
+
+		t += gap / closing_speed;
+		if (t > max_distance) {
+			return false;
+		}
+	}
+
+	return false;
+}
+
+bool ray_sphere(const Vec3 origin, const Vec3 direction, const Vec3 center, const float radius, const float max_distance, float* const distance) {
+	const Vec3 offset = vec3_sub(origin, center);
+	const float b = vec3_dot(offset, direction);
+	const float c = vec3_dot(offset, offset) - radius * radius;
+	if (c <= 0) {
+		*distance = 0;
+		return true;
+	}
+
+	const float discriminant = b * b - c;
+	if (b > 0 || discriminant < 0) {
+		return false;
+	}
+
+	*distance = -b - sqrtf(discriminant);
+	return *distance <= max_distance;
+}
+
+// Ray against a capsule along y in its body space. The caps are only tested as whole spheres,
+// a cap hit inside the cylinder part is never nearer than the cylinder hit.
+bool ray_capsule(const Vec3 origin, const Vec3 direction, const float half_height, const float radius, const float max_distance, float* const distance, Vec3* const normal) {
+	const Vec3 axis_point = { 0, fmaxf(-half_height, fminf(half_height, origin.y)), 0 };
+	const Vec3 offset = vec3_sub(origin, axis_point);
+	if (vec3_dot(offset, offset) <= radius * radius) {
+		*distance = 0;
+		*normal = vec3_scale(direction, -1);
+		return true;
+	}
+
+	float best = FLT_MAX;
+	const float a = direction.x * direction.x + direction.z * direction.z;
+	if (a > 1e-12f) {
+		const float b = origin.x * direction.x + origin.z * direction.z;
+		const float c = origin.x * origin.x + origin.z * origin.z - radius * radius;
+		const float discriminant = b * b - a * c;
+		if (discriminant >= 0) {
+			const float t = (-b - sqrtf(discriminant)) / a;
+			const float y = origin.y + direction.y * t;
+			if (t >= 0 && fabsf(y) <= half_height) {
+				best = t;
+				*normal = vec3_scale(new_vec3(origin.x + direction.x * t, 0, origin.z + direction.z * t), 1 / radius);
+			}
+		}
+	}
+
+	for (int i = 0; i < 2; i++) {
+		const Vec3 center = { 0, i ? half_height : -half_height, 0 };
+		float t;
+		if (ray_sphere(origin, direction, center, radius, max_distance, &t) && t < best) {
+			best = t;
+			*normal = vec3_scale(vec3_sub(vec3_add(origin, vec3_scale(direction, t)), center), 1 / radius);
+		}
+	}
+
+	*distance = best;
+	return best <= max_distance;
+}
+
+// Slab test in the unit cube space of the box's inverse transform. The transform is affine, so
+// distances along the mapped ray are the same as along the world space one.
+bool ray_box(const Cast* const cast, Cube* const box, const float max_distance, QueryHit* const hit) {
+	const Mat4* const inverse_transform = cube_inverse_transform(box);
+	const Vec3 origin = vec3_mul_mat4(cast->origin, inverse_transform);
+	const Vec4 mapped = vec4_mul_mat4((Vec4){ cast->direction.x, cast->direction.y, cast->direction.z, 0 }, inverse_transform);
+	const float origins[3] = { origin.x, origin.y, origin.z };
+	const float directions[3] = { mapped.x, mapped.y, mapped.z };
+
+	float entry = 0;
+	float leave = max_distance;
+	int entry_axis = -1;
+	for (int axis = 0; axis < 3; axis++) {
+		if (fabsf(directions[axis]) < 1e-12f) {
+			if (fabsf(origins[axis]) > 0.5f) {
+				return false;
+			}
+			continue;
+		}
+
+		float t0 = (-0.5f - origins[axis]) / directions[axis];
+		float t1 = (0.5f - origins[axis]) / directions[axis];
+		if (t0 > t1) {
+			const float swap = t0;
+			t0 = t1;
+			t1 = swap;
+		}
+		if (t0 > entry) {
+			entry = t0;
+			entry_axis = axis;
+		}
+		leave = fminf(leave, t1);
+		if (entry > leave) {
+			return false;
+		}
+	}
+
+	Vec3 normal = vec3_scale(cast->direction, -1);
+	if (entry_axis >= 0) {
+		float local_normal[3] = {};
+		local_normal[entry_axis] = directions[entry_axis] > 0 ? -1 : 1;
+		normal = vec3_mul_mat3(new_vec3(local_normal[0], local_normal[1], local_normal[2]), &box->orientation);
+	}
+
+	hit_set(hit, box, entry, vec3_add(cast->origin, vec3_scale(cast->direction, entry)), normal);
+	return true;
+}
+
+// Two sided ray and triangle test of Moeller and Trumbore
+bool ray_triangle(const Vec3 origin, const Vec3 direction, const Vec3* const triangle, const float max_distance, float* const distance, Vec3* const normal) {
+	const Vec3 edge_1 = vec3_sub(triangle[1], triangle[0]);
+	const Vec3 edge_2 = vec3_sub(triangle[2], triangle[0]);
+	const Vec3 p = vec3_cross(direction, edge_2);
+	const float determinant = vec3_dot(edge_1, p);
+	if (fabsf(determinant) < 1e-12f) {
+		return false;
+	}
+
+	const float inverse_determinant = 1 / determinant;
+	const Vec3 s = vec3_sub(origin, triangle[0]);
+	const float u = vec3_dot(s, p) * inverse_determinant;
+	if (u < 0 || u > 1) {
+		return false;
+	}
+
+	const Vec3 q = vec3_cross(s, edge_1);
+	const float v = vec3_dot(direction, q) * inverse_determinant;
+	if (v < 0 || u + v > 1) {
+		return false;
+	}
+
+	const float t = vec3_dot(edge_2, q) * inverse_determinant;
+	if (t < 0 || t > max_distance) {
+		return false;
+	}
+
+	*distance = t;
+	*normal = vec3_normalize(vec3_cross(edge_1, edge_2));
+	if (vec3_dot(*normal, direction) > 0) {
+		*normal = vec3_scale(*normal, -1);
+	}
+	return true;
+}
+
+// Cast in the body space of a mesh or heightfield, collecting the nearest triangle hit
+typedef struct {
+	const Cast* cast;
+	Cube* cube;
+	QueryHit hit;
+	bool found;
+} TriangleCast;
+
+float triangle_cast_callback(void* const context, const Vec3* const triangle, const float max_distance) {
+	TriangleCast* const triangle_cast = context;
+	const Cast* const cast = triangle_cast->cast;
+
+	if (cast->type == CAST_RAY) {
+		float distance;
+		Vec3 normal;
+		if (!ray_triangle(cast->origin, cast->direction, triangle, max_distance, &distance, &normal)) {
+			return max_distance;
+		}
+		hit_set(&triangle_cast->hit, triangle_cast->cube, distance, vec3_add(cast->origin, vec3_scale(cast->direction, distance)), normal);
+		triangle_cast->found = true;
+		return distance;
+	}
+
+	Vec3 vertices[3] = { triangle[0], triangle[1], triangle[2] };
+	const ConvexProxy target = { triangle_support, vertices, { {}, MAT3_IDENTITY } };
+	QueryHit hit;
+	if (!convex_cast(cast, triangle_cast->cube, &target, max_distance, &hit) || hit.distance > max_distance) {
+		return max_distance;
+	}
+	triangle_cast->hit = hit;
+	triangle_cast->found = true;
+	return hit.distance;
+}
+
+// Nearest hit of the cast on a box, sphere, capsule or hull before max_distance
+bool cast_shape(const Cast* const cast, Cube* const cube, const float max_distance, QueryHit* const hit) {
+	const Pose pose = cube_pose(cube);
+
+	// Rays and spheres against round shapes are the ray against the shape grown by the radius
+	if (cast->type == CAST_BOX || (cast->type == CAST_SPHERE && cube->shape != SHAPE_SPHERE && cube->shape != SHAPE_CAPSULE)) {
+		SupportContext context = { cube, 0 };
+		const ConvexProxy target = { body_support, &context, pose };
+		return convex_cast(cast, cube, &target, max_distance, hit) && hit->distance <= max_distance;
+	}
+
+	switch (cube->shape) {
+		case SHAPE_BOX: {
+			return ray_box(cast, cube, max_distance, hit);
+		}
+		case SHAPE_SPHERE: {
+			const float radius = cube->radius + cast->radius;
+			float distance;
+			if (!ray_sphere(cast->origin, cast->direction, cube->position, radius, max_distance, &distance)) {
+				return false;
+			}
+			const Vec3 center = vec3_add(cast->origin, vec3_scale(cast->direction, distance));
+			const Vec3 normal = distance > 0 ? vec3_scale(vec3_sub(center, cube->position), 1 / radius) : vec3_scale(cast->direction, -1);
+			hit_set(hit, cube, distance, vec3_add(cube->position, vec3_scale(normal, cube->radius)), normal);
+			return true;
+		}
+		case SHAPE_CAPSULE: {
+			const Cast local = cast_to_local(cast, &pose);
+			float distance;
+			Vec3 normal;
+			if (!ray_capsule(local.origin, local.direction, cube->half_height, cube->radius + cast->radius, max_distance, &distance, &normal)) {
+				return false;
+			}
+			const Vec3 center = vec3_add(local.origin, vec3_scale(local.direction, distance));
+			hit_set(hit, cube, distance, vec3_sub(center, vec3_scale(normal, cast->radius)), normal);
+			hit_to_world(hit, &pose);
+			return true;
+		}
+		default: {
+			SupportContext context = { cube, 0 };
+			const ConvexProxy target = { body_support, &context, pose };
+			return convex_cast(cast, cube, &target, max_distance, hit) && hit->distance <= max_distance;
+		}
+	}
+}
+
+// Casts against the children of a compound the cast passes, reporting hits on the compound
+bool cast_compound(const Cast* const cast, Cube* const cube, float max_distance, QueryHit* const hit) {
+	const Pose pose = cube_pose(cube);
+	const Cast local = cast_to_local(cast, &pose);
+
+	int children[COMPOUND_MAX_CHILDREN];
+	float entries[COMPOUND_MAX_CHILDREN];
+	const int num_children = aabb_tree_raycast(&cube->compound->tree, local.origin, local.direction, max_distance, local.inflate, children, entries, COMPOUND_MAX_CHILDREN);
+
+	bool found = false;
+	for (int k = 0; k < num_children; k++) {
+		Cube child_body;
+		compound_child_body(&child_body, cube, &cube->compound->children[children[k]], &pose);
+
+		QueryHit child_hit;
+		if (cast_shape(cast, &child_body, max_distance, &child_hit)) {
+			*hit = child_hit;
+			hit->cube = cube;
+			max_distance = child_hit.distance;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+// Nearest hit of the cast on one body before max_distance
+bool cast_body(const Cast* const cast, Cube* const cube, const float max_distance, QueryHit* const hit) {
+	if (cube->shape == SHAPE_COMPOUND) {
+		return cast_compound(cast, cube, max_distance, hit);
+	}
+	if (cube->shape != SHAPE_MESH && cube->shape != SHAPE_HEIGHTFIELD) {
+		return cast_shape(cast, cube, max_distance, hit);
+	}
+
+	const Pose pose = cube_pose(cube);
+	const Cast local = cast_to_local(cast, &pose);
+	TriangleCast triangle_cast = { &local, cube };
+	if (cube->shape == SHAPE_MESH) {
+		triangle_mesh_cast(cube->mesh, local.origin, local.direction, max_distance, local.inflate, triangle_cast_callback, &triangle_cast);
+	} else {
+		heightfield_cast(cube->heightfield, local.origin, local.direction, max_distance, local.inflate, triangle_cast_callback, &triangle_cast);
+	}
+	if (!triangle_cast.found) {
+		return false;
+	}
+
+	*hit = triangle_cast.hit;
+	hit_to_world(hit, &pose);
+	return true;
+}
+
+// The floor is the half space below y = 0, the lowest point of the cast shape is inflate.y below its origin
+bool cast_floor(const Cast* const cast, const float max_distance, QueryHit* const hit) {
+	const float height = cast->origin.y - cast->inflate.y;
+	const Vec3 normal = { 0, 1, 0 };
+	if (height <= 0) {
+		hit_set(hit, &GROUND, 0, new_vec3(cast->origin.x, 0, cast->origin.z), normal);
+		return true;
+	}
+	if (cast->direction.y >= 0 || height > -cast->direction.y * max_distance) {
+		return false;
+	}
+
+	const float distance = height / -cast->direction.y;
+	const Vec3 center = vec3_add(cast->origin, vec3_scale(cast->direction, distance));
+	hit_set(hit, &GROUND, distance, new_vec3(center.x, 0, center.z), normal);
+	return true;
+}
+
+// Bodies whose broadphase bounds the cast passes, nearest entry first
+int cast_candidates(const Cast* const cast, const float max_distance, int* const candidates, float* const entries) {
+	broadphase_refresh();
+
+	int num_candidates = aabb_tree_raycast(&STATIC_TREE, cast->origin, cast->direction, max_distance, cast->inflate, candidates, entries, MAX_CUBES);
+	num_candidates += aabb_tree_raycast(&MOVING_TREE, cast->origin, cast->direction, max_distance, cast->inflate, candidates + num_candidates, entries + num_candidates, MAX_CUBES - num_candidates);
+
+	for (int k = 1; k < num_candidates; k++) {
+		const int candidate = candidates[k];
+		const float entry = entries[k];
+		int m = k - 1;
+		while (m >= 0 && entries[m] > entry) {
+			candidates[m + 1] = candidates[m];
+			entries[m + 1] = entries[m];
+			m--;
+		}
+		candidates[m + 1] = candidate;
+		entries[m + 1] = entry;
+	}
+
+	return num_candidates;
+}
+
+bool cast_closest(const Cast* const cast, float max_distance, QueryHit* const hit) {
+	// The floor goes first, so the trees are only walked up to it
+	bool found = cast_floor(cast, max_distance, hit);
+	if (found) {
+		max_distance = hit->distance;
+	}
+
+	int candidates[MAX_CUBES];
+	float entries[MAX_CUBES];
+	const int num_candidates = cast_candidates(cast, max_distance, candidates, entries);
+
+	for (int k = 0; k < num_candidates && entries[k] <= max_distance; k++) {
+		QueryHit candidate_hit;
+		if (cast_body(cast, &CUBES[candidates[k]], max_distance, &candidate_hit)) {
+			*hit = candidate_hit;
+			max_distance = candidate_hit.distance;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+int cast_all(const Cast* const cast, const float max_distance, QueryHit* const hits, const int max_hits) {
+	int candidates[MAX_CUBES];
+	float entries[MAX_CUBES];
+	const int num_candidates = cast_candidates(cast, max_distance, candidates, entries);
+
+	int num_hits = 0;
+	for (int k = -1; k < num_candidates; k++) {
+		QueryHit hit;
+		const bool found = k < 0 ? cast_floor(cast, max_distance, &hit) : cast_body(cast, &CUBES[candidates[k]], max_distance, &hit);
+		if (!found) {
+			continue;
+		}
+
+		// Insert by distance, dropping the furthest once full
+		if (num_hits == max_hits) {
+			if (max_hits == 0 || hits[max_hits - 1].distance <= hit.distance) {
+				continue;
+			}
+			num_hits--;
+		}
+
+		int m = num_hits++;
+		while (m > 0 && hits[m - 1].distance > hit.distance) {
+			hits[m] = hits[m - 1];
+			m--;
+		}
+		hits[m] = hit;
+	}
+
+	return num_hits;
+}
+
+bool raycast_closest(const Vec3 origin, const Vec3 direction, const float max_distance, QueryHit* const hit) {
+	const Cast cast = cast_make(CAST_RAY, origin, MAT3_IDENTITY, (Vec3){}, 0, direction);
+	return cast_closest(&cast, max_distance, hit);
+}
+
+int raycast_all(const Vec3 origin, const Vec3 direction, const float max_distance, QueryHit* const hits, const int max_hits) {
+	const Cast cast = cast_make(CAST_RAY, origin, MAT3_IDENTITY, (Vec3){}, 0, direction);
+	return cast_all(&cast, max_distance, hits, max_hits);
+}
+
+bool spherecast_closest(const Vec3 origin, const float radius, const Vec3 direction, const float max_distance, QueryHit* const hit) {
+	const Cast cast = cast_make(CAST_SPHERE, origin, MAT3_IDENTITY, (Vec3){}, radius, direction);
+	return cast_closest(&cast, max_distance, hit);
+}
+
+int spherecast_all(const Vec3 origin, const float radius, const Vec3 direction, const float max_distance, QueryHit* const hits, const int max_hits) {
+	const Cast cast = cast_make(CAST_SPHERE, origin, MAT3_IDENTITY, (Vec3){}, radius, direction);
+	return cast_all(&cast, max_distance, hits, max_hits);
+}
+
+bool boxcast_closest(const Pose* const pose, const Vec3 half_extents, const Vec3 direction, const float max_distance, QueryHit* const hit) {
+	const Cast cast = cast_make(CAST_BOX, pose->position, pose->orientation, half_extents, 0, direction);
+	return cast_closest(&cast, max_distance, hit);
+}
+
+int boxcast_all(const Pose* const pose, const Vec3 half_extents, const Vec3 direction, const float max_distance, QueryHit* const hits, const int max_hits) {
+	const Cast cast = cast_make(CAST_BOX, pose->position, pose->orientation, half_extents, 0, direction);
+	return cast_all(&cast, max_distance, hits, max_hits);
+}
+
+#ifdef KINESIS_SIMD_SSE
+// Four rays through one tree: a node is entered when any ray that has not hit something nearer
+// passes through its bounds, and its body is then tested ray by ray
+void raycast_packet_tree(const AabbTree* const tree, const Cast* const casts, float* const best, QueryHit* const hits) {
+	if (tree->root < 0) {
+		return;
+	}
+
+	const Vec4x origin_x = _mm_set_ps(casts[3].origin.x, casts[2].origin.x, casts[1].origin.x, casts[0].origin.x);
+	const Vec4x origin_y = _mm_set_ps(casts[3].origin.y, casts[2].origin.y, casts[1].origin.y, casts[0].origin.y);
+	const Vec4x origin_z = _mm_set_ps(casts[3].origin.z, casts[2].origin.z, casts[1].origin.z, casts[0].origin.z);
+	const Vec4x one = _mm_set1_ps(1);
+	const Vec4x inverse_x = _mm_div_ps(one, _mm_set_ps(casts[3].direction.x, casts[2].direction.x, casts[1].direction.x, casts[0].direction.x));
+	const Vec4x inverse_y = _mm_div_ps(one, _mm_set_ps(casts[3].direction.y, casts[2].direction.y, casts[1].direction.y, casts[0].direction.y));
+	const Vec4x inverse_z = _mm_div_ps(one, _mm_set_ps(casts[3].direction.z, casts[2].direction.z, casts[1].direction.z, casts[0].direction.z));
+
+	int stack[64];
+	int stack_size = 0;
+	stack[stack_size++] = tree->root;
+
+	while (stack_size > 0) {
+		const AabbNode* const node = &tree->nodes[stack[--stack_size]];
+
+		const Vec4x x0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node->min.x), origin_x), inverse_x);
+		const Vec4x x1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node->max.x), origin_x), inverse_x);
+		const Vec4x y0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node->min.y), origin_y), inverse_y);
+		const Vec4x y1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node->max.y), origin_y), inverse_y);
+		const Vec4x z0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node->min.z), origin_z), inverse_z);
+		const Vec4x z1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node->max.z), origin_z), inverse_z);
+
+		const Vec4x entry = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_max_ps(_mm_min_ps(z0, z1), _mm_setzero_ps()));
+		const Vec4x leave = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_min_ps(_mm_max_ps(z0, z1), _mm_loadu_ps(best)));
+		const int mask = _mm_movemask_ps(_mm_cmple_ps(entry, leave));
+		if (mask == 0) {
+			continue;
+		}
+
+		if (node->index < 0) {
+			stack[stack_size++] = node->left;
+			stack[stack_size++] = node->right;
+			continue;
+		}
+
+		for (int lane = 0; lane < 4; lane++) {
+			QueryHit hit;
+			if ((mask >> lane & 1) && cast_body(&casts[lane], &CUBES[node->index], best[lane], &hit)) {
+				hits[lane] = hit;
+				best[lane] = hit.distance;
+			}
+		}
+	}
+}
+#endif
+
+void raycast_batch(const Vec3* const origins, const Vec3* const directions, const int count, const float max_distance, QueryHit* const hits) {
+	broadphase_refresh();
+	int i = 0;
+
+#ifdef KINESIS_SIMD_SSE
+	for (; i + 4 <= count; i += 4) {
+		Cast casts[4];
+		float best[4];
+		for (int lane = 0; lane < 4; lane++) {
+			casts[lane] = cast_make(CAST_RAY, origins[i + lane], MAT3_IDENTITY, (Vec3){}, 0, directions[i + lane]);
+			hits[i + lane] = (QueryHit){};
+			best[lane] = cast_floor(&casts[lane], max_distance, &hits[i + lane]) ? hits[i + lane].distance : max_distance;
+		}
+		raycast_packet_tree(&STATIC_TREE, casts, best, hits + i);
+		raycast_packet_tree(&MOVING_TREE, casts, best, hits + i);
+	}
+#endif
+
+	for (; i < count; i++) {
+		hits[i] = (QueryHit){};
+		raycast_closest(origins[i], directions[i], max_distance, &hits[i]);
+	}
+}
+
+// Whether the sphere or box of the cast at its origin touches a convex target
+bool convex_overlaps(const Cast* const cast, const ConvexProxy* const target) {
+	Vec3 half_extents = cast->half_extents;
+	const ConvexProxy query = { cast_support, &half_extents, { cast->origin, cast->orientation } };
+	GjkSimplex simplex = {};
+	const GjkResult result = gjk_distance(&query, target, &simplex, cast->gjk_iterations);
+	return result.intersecting || result.distance <= cast->radius;
+}
+
+typedef struct {
+	const Cast* cast;
+	bool found;
+} TriangleOverlap;
+
+// Returns a negative distance once a triangle overlaps, which ends the walk over the triangles
+float triangle_overlap_callback(void* const context, const Vec3* const triangle, const float max_distance) {
+	TriangleOverlap* const overlap = context;
+	if (max_distance < 0) {
+		return max_distance;
+	}
+
+	Vec3 vertices[3] = { triangle[0], triangle[1], triangle[2] };
+	const ConvexProxy target = { triangle_support, vertices, { {}, MAT3_IDENTITY } };
+	if (!convex_overlaps(overlap->cast, &target)) {
+		return max_distance;
+	}
+	overlap->found = true;
+	return -1;
+}
+
+bool shape_overlaps(const Cast* const cast, const Cube* const cube) {
+	if (cast->type == CAST_SPHERE && cube->shape == SHAPE_SPHERE) {
+		const Vec3 offset = vec3_sub(cast->origin, cube->position);
+		const float radius = cast->radius + cube->radius;
+		return vec3_dot(offset, offset) <= radius * radius;
+	}
+
+	SupportContext context = { cube, 0 };
+	const ConvexProxy target = { body_support, &context, cube_pose(cube) };
+	return convex_overlaps(cast, &target);
+}
+
+// Only reads the bodies, unlike the casts which may rebuild the cached box transforms
+bool body_overlaps(const Cast* const cast, const Cube* const cube) {
+	if (cube->shape != SHAPE_COMPOUND && cube->shape != SHAPE_MESH && cube->shape != SHAPE_HEIGHTFIELD) {
+		return shape_overlaps(cast, cube);
+	}
+
+	const Pose pose = cube_pose(cube);
+	const Cast local = cast_to_local(cast, &pose);
+	if (cube->shape == SHAPE_COMPOUND) {
+		int children[COMPOUND_MAX_CHILDREN];
+		const int num_children = aabb_tree_query(&cube->compound->tree, vec3_sub(local.origin, local.inflate), vec3_add(local.origin, local.inflate), children, COMPOUND_MAX_CHILDREN);
+		for (int k = 0; k < num_children; k++) {
+			Cube child_body;
+			compound_child_body(&child_body, cube, &cube->compound->children[children[k]], &pose);
+			if (shape_overlaps(cast, &child_body)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// A cast of length zero visits the triangles within inflate of the origin
+	TriangleOverlap overlap = { &local };
+	if (cube->shape == SHAPE_MESH) {
+		triangle_mesh_cast(cube->mesh, local.origin, local.direction, 0, local.inflate, triangle_overlap_callback, &overlap);
+	} else {
+		heightfield_cast(cube->heightfield, local.origin, local.direction, 0, local.inflate, triangle_overlap_callback, &overlap);
+	}
+	return overlap.found;
+}
+
+int overlap_cast(const Cast* const cast, Cube** const results, const int max_results) {
+	const Vec3 min = vec3_sub(cast->origin, cast->inflate);
+	const Vec3 max = vec3_add(cast->origin, cast->inflate);
+	int candidates[MAX_CUBES];
+	int num_candidates = aabb_tree_query(&STATIC_TREE, min, max, candidates, MAX_CUBES);
+	num_candidates += aabb_tree_query(&MOVING_TREE, min, max, candidates + num_candidates, MAX_CUBES - num_candidates);
+
+	int num_results = 0;
+	for (int k = 0; k < num_candidates && num_results < max_results; k++) {
+		Cube* const cube = &CUBES[candidates[k]];
+		if (body_overlaps(cast, cube)) {
+			results[num_results++] = cube;
+		}
+	}
+	return num_results;
+}
+
+// Even the point of the shape furthest along the inward normal is behind the plane
+bool shape_outside_plane(const Cube* const cube, const Vec4 plane) {
+	const Pose pose = cube_pose(cube);
+	const Vec3 normal = { plane.x, plane.y, plane.z };
+	SupportContext context = { cube, 0 };
+	const Vec3 furthest = pose_to_world(&pose, body_support(&context, rotate_to_local(&pose.orientation, normal)));
+	return vec3_dot(normal, furthest) + plane.w < 0;
+}
+
+bool shape_inside_frustum(const Cube* const cube, const Frustum* const frustum) {
+	for (int i = 0; i < 6; i++) {
+		if (shape_outside_plane(cube, frustum->planes[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool body_inside_frustum(const Cube* const cube, const Frustum* const frustum) {
+	if (cube->shape == SHAPE_MESH || cube->shape == SHAPE_HEIGHTFIELD) {
+		// Its bounds already passed the planes in the broadphase
+		return true;
+	}
+	if (cube->shape != SHAPE_COMPOUND) {
+		return shape_inside_frustum(cube, frustum);
+	}
+
+	// The planes in compound space cull the children through the compound's tree
+	const Pose pose = cube_pose(cube);
+	Vec4 local_planes[6];
+	for (int i = 0; i < 6; i++) {
+		const Vec4 plane = frustum->planes[i];
+		const Vec3 normal = rotate_to_local(&pose.orientation, new_vec3(plane.x, plane.y, plane.z));
+		local_planes[i] = (Vec4){ normal.x, normal.y, normal.z, plane.w + plane.x * pose.position.x + plane.y * pose.position.y + plane.z * pose.position.z };
+	}
+
+	int children[COMPOUND_MAX_CHILDREN];
+	const int num_children = aabb_tree_query_planes(&cube->compound->tree, local_planes, 6, children, COMPOUND_MAX_CHILDREN);
+	for (int k = 0; k < num_children; k++) {
+		Cube child_body;
+		compound_child_body(&child_body, cube, &cube->compound->children[children[k]], &pose);
+		if (shape_inside_frustum(&child_body, frustum)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int overlap_planes(const Frustum* const frustum, Cube** const results, const int max_results) {
+	int candidates[MAX_CUBES];
+	int num_candidates = aabb_tree_query_planes(&STATIC_TREE, frustum->planes, 6, candidates, MAX_CUBES);
+	num_candidates += aabb_tree_query_planes(&MOVING_TREE, frustum->planes, 6, candidates + num_candidates, MAX_CUBES - num_candidates);
+
+	int num_results = 0;
+	for (int k = 0; k < num_candidates && num_results < max_results; k++) {
+		Cube* const cube = &CUBES[candidates[k]];
+		if (body_inside_frustum(cube, frustum)) {
+			results[num_results++] = cube;
+		}
+	}
+	return num_results;
+}
+
+// Overlap shapes do not move, the direction only steers the walk over mesh triangles
+Cast overlap_make(const CastType type, const Pose* const pose, const Vec3 half_extents, const float radius) {
+	return cast_make(type, pose->position, pose->orientation, half_extents, radius, new_vec3(0, -1, 0));
+}
+
+// Rows of the matrix combined as by Gribb and Hartmann, normalized so w is a distance
+Frustum frustum_from_matrix(const Mat4* const view_projection) {
+	const float (*const m)[4] = view_projection->m;
+	Frustum frustum;
+	for (int i = 0; i < 6; i++) {
+		const float sign = i % 2 ? -1 : 1;
+		const int row = i / 2;
+		const Vec4 plane = {
+			m[3][0] + sign * m[row][0],
+			m[3][1] + sign * m[row][1],
+			m[3][2] + sign * m[row][2],
+			m[3][3] + sign * m[row][3]
+		};
+		const float inverse_length = 1 / sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		frustum.planes[i] = (Vec4){ plane.x * inverse_length, plane.y * inverse_length, plane.z * inverse_length, plane.w * inverse_length };
+	}
+	return frustum;
+}
+
+int overlap_sphere(const Vec3 center, const float radius, Cube** const results, const int max_results) {
+	broadphase_refresh();
+	const Pose pose = { center, MAT3_IDENTITY };
+	const Cast cast = overlap_make(CAST_SPHERE, &pose, (Vec3){}, radius);
+	return overlap_cast(&cast, results, max_results);
+}
+
+int overlap_box(const Pose* const pose, const Vec3 half_extents, Cube** const results, const int max_results) {
+	broadphase_refresh();
+	const Cast cast = overlap_make(CAST_BOX, pose, half_extents, 0);
+	return overlap_cast(&cast, results, max_results);
+}
+
+int overlap_frustum(const Frustum* const frustum, Cube** const results, const int max_results) {
+	broadphase_refresh();
+	return overlap_planes(frustum, results, max_results);
+}
+
+typedef struct {
+	const OverlapQuery* queries;
+	Cube** results;
+	int results_per_query;
+	int* counts;
+	long gjk_iterations; // Summed over the jobs, added to SIM_STATS once they are done
+} OverlapBatch;
+
+void overlap_batch_job(void* const context, const int first, const int count) {
+	OverlapBatch* const batch = context;
+	int gjk_iterations = 0;
+	for (int i = first; i < first + count; i++) {
+		const OverlapQuery* const query = &batch->queries[i];
+		Cube** const results = batch->results + i * batch->results_per_query;
+
+		if (query->type == OVERLAP_FRUSTUM) {
+			batch->counts[i] = overlap_planes(query->frustum, results, batch->results_per_query);
+		} else {
+			Cast cast = query->type == OVERLAP_SPHERE
+				? overlap_make(CAST_SPHERE, &(Pose){ query->pose.position, MAT3_IDENTITY }, (Vec3){}, query->radius)
+				: overlap_make(CAST_BOX, &query->pose, query->half_extents, 0);
+			cast.gjk_iterations = &gjk_iterations;
+			batch->counts[i] = overlap_cast(&cast, results, batch->results_per_query);
+		}
+	}
+	ATOMIC_ADD(&batch->gjk_iterations, gjk_iterations);
+}
+
+void overlap_batch(const OverlapQuery* const queries, const int count, Cube** const results, const int results_per_query, int* const counts) {
+	// The trees are brought up to date once here, the job threads only read them
+	broadphase_refresh();
+	OverlapBatch batch = { queries, results, results_per_query, counts, 0 };
+	jobs_parallel_for(count, OVERLAP_BATCH_SIZE, overlap_batch_job, &batch);
+	SIM_STATS.gjk_iterations += (int)batch.gjk_iterations;
+}
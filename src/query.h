@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdbool.h>
+#include "physics.h"
+
+// Ray casts and sphere and box casts against every active body, with candidates found through
+// the broadphase trees. Directions must not be zero and are normalized by the queries, so
+// distances are world space lengths. A cast that starts inside a body hits it at distance 0,
+// with the normal against the direction when the overlap has no better one. The floor plane
+// is hit as the body GROUND.
+
+typedef struct {
+	Cube* cube; // The compound for hits on a child of a compound
+	float distance; // Along the direction, how far the ray or cast shape moved until it touched
+	Vec3 point; // World space, on the surface of the hit body
+	Vec3 normal; // World space, points out of the hit body
+} QueryHit;
+
+bool raycast_closest(const Vec3 origin, const Vec3 direction, const float max_distance, QueryHit* const hit);
+
+// One hit for every body the ray reaches before max_distance, nearest first. Returns how many
+// hits were written, the nearest max_hits are kept.
+int raycast_all(const Vec3 origin, const Vec3 direction, const float max_distance, QueryHit* const hits, const int max_hits);
+
+bool spherecast_closest(const Vec3 origin, const float radius, const Vec3 direction, const float max_distance, QueryHit* const hit);
+int spherecast_all(const Vec3 origin, const float radius, const Vec3 direction, const float max_distance, QueryHit* const hits, const int max_hits);
+
+// The box starts at pose and keeps its orientation while it moves
+bool boxcast_closest(const Pose* const pose, const Vec3 half_extents, const Vec3 direction, const float max_distance, QueryHit* const hit);
+int boxcast_all(const Pose* const pose, const Vec3 half_extents, const Vec3 direction, const float max_distance, QueryHit* const hits, const int max_hits);
+
+// Closest hit of each of count rays, hits[i].cube is NULL when ray i hit nothing. With the SIMD
+// backend the rays go through the broadphase trees four at a time.
+void raycast_batch(const Vec3* const origins, const Vec3* const directions, const int count, const float max_distance, QueryHit* const hits);
+
+// Overlap queries write every body whose shape touches a sphere, box or frustum to results, in
+// no particular order, and return how many were written, at most max_results. Candidates come
+// from the broadphase trees. The floor is not reported.
+
+typedef struct {
+	Vec4 planes[6]; // x, y, z is the inward normal and w the offset, inside where dot(normal, point) + w >= 0
+} Frustum;
+
+// Left, right, bottom, top, near and far planes of a projection times view matrix with OpenGL clip space
+Frustum frustum_from_matrix(const Mat4* const view_projection);
+
+int overlap_sphere(const Vec3 center, const float radius, Cube** const results, const int max_results);
+int overlap_box(const Pose* const pose, const Vec3 half_extents, Cube** const results, const int max_results);
+
+// Bodies are only tested against the planes one by one, so a body just outside a corner of the
+// frustum may still be reported. Meshes and heightfields are tested with their bounds.
+int overlap_frustum(const Frustum* const frustum, Cube** const results, const int max_results);
+
+typedef enum {
+	OVERLAP_SPHERE,
+	OVERLAP_BOX,
+	OVERLAP_FRUSTUM
+} OverlapType;
+
+typedef struct {
+	OverlapType type;
+	Pose pose; // Box pose, the sphere center is pose.position
+	Vec3 half_extents; // Boxes
+	float radius; // Spheres
+	const Frustum* frustum; // Frustums
+} OverlapQuery;
+
+// Answers count queries on the job threads. Query i writes up to results_per_query bodies to
+// results + i * results_per_query and how many to counts[i]. Bodies must not change until it
+// returns.
+void overlap_batch(const OverlapQuery* const queries, const int count, Cube** const results, const int results_per_query, int* const counts);
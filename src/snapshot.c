@@ -0,0 +1,72 @@
+#include "snapshot.h"
+#include "body_state.h"
+#include "physics.h"
+#include "stats.h"
+#include <string.h>
+
+static const uint32_t SNAPSHOT_MAGIC = 0x504e534b; // "KSNP"
+
+int snapshot_sections(StateSection* const sections) {
+	int count = physics_state_sections(sections);
+	count += contact_events_state_sections(sections + count);
+	return count;
+}
+
+size_t snapshot_size() {
+	StateSection sections[MAX_STATE_SECTIONS];
+	const int num_sections = snapshot_sections(sections);
+
+	size_t size = sizeof(SnapshotHeader);
+	for (int i = 0; i < num_sections; i++) {
+		size += sections[i].size;
+	}
+	return size;
+}
+
+void snapshot_save(void* const blob) {
+	StateSection sections[MAX_STATE_SECTIONS];
+	const int num_sections = snapshot_sections(sections);
+
+	unsigned char* data = blob;
+	const SnapshotHeader header = {
+		.magic = SNAPSHOT_MAGIC,
+		.version = SNAPSHOT_VERSION,
+		.size = snapshot_size(),
+		.step_index = SIM_STATS.step_index,
+		.delta_time = DELTA_TIME
+	};
+	memcpy(data, &header, sizeof(header));
+	data += sizeof(header);
+
+	for (int i = 0; i < num_sections; i++) {
+		memcpy(data, sections[i].data, sections[i].size);
+		data += sections[i].size;
+	}
+}
+
+bool snapshot_restore(const void* const blob) {
+	SnapshotHeader header;
+	memcpy(&header, blob, sizeof(header));
+	if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION || header.size != snapshot_size()) {
+		return false;
+	}
+
+	StateSection sections[MAX_STATE_SECTIONS];
+	const int num_sections = snapshot_sections(sections);
+
+	const unsigned char* data = (const unsigned char*)blob + sizeof(header);
+	for (int i = 0; i < num_sections; i++) {
+		memcpy(sections[i].data, data, sections[i].size);
+		data += sections[i].size;
+	}
+
+	SIM_STATS.step_index = header.step_index;
+	DELTA_TIME = header.delta_time;
+
+	// Exports filtered by stamp have to see the bodies jump back
+	for (int i = 0; i < MAX_CUBES; i++) {
+		CUBES[i].state_stamp = BODY_STATE_CLOCK;
+	}
+	broadphase_invalidate();
+	return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Whole simulation state in one contiguous blob, for rolling back and stepping again. Restoring
+// a snapshot and stepping reproduces the original steps bit for bit. Bodies, contacts, the GJK
+// warm start cache, touching pairs and the step index are saved, the broadphase trees are
+// rebuilt by the next step. Commands still waiting in the command buffer are not part of it.
+// The blob holds raw pointers, the shapes of bodies and the bodies of contacts and touching
+// pairs, so it can only be restored in the process that saved it and while the shapes it
+// points to are still alive. It is not a save file or a network format.
+
+enum { SNAPSHOT_VERSION = 1 };
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t size; // Bytes of the whole blob, header included
+	uint64_t step_index; // SIM_STATS.step_index when saved
+	double delta_time;
+} SnapshotHeader;
+
+// Same for every snapshot of a build
+size_t snapshot_size();
+
+// blob has room for snapshot_size() bytes
+void snapshot_save(void* const blob);
+
+// Returns false and leaves the world as it was if the blob is from another version or build.
+// Blobs from another process are not detected and must not be passed in.
+// All bodies count as changed for body_state_export afterwards.
+bool snapshot_restore(const void* const blob);
+
+// Memory a module keeps from one step to the next
+typedef struct {
+	void* data;
+	size_t size;
+} StateSection;
+
+enum { MAX_STATE_SECTIONS = 16 };
+
+// Called by snapshot_save and snapshot_restore, return the number of sections written
+int physics_state_sections(StateSection* const sections);
+int contact_events_state_sections(StateSection* const sections);
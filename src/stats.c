@@ -0,0 +1,77 @@
+#include "stats.h"
+
+SimStats SIM_STATS = {};
+
+FILE* STATS_CSV_LOG = NULL;
+
+const SimStats* stats_get() {
+	return &SIM_STATS;
+}
+
+// Clears the per-step counters, the step index keeps counting
+void stats_begin_step() {
+	const uint64_t step_index = SIM_STATS.step_index;
+	SIM_STATS = (SimStats){};
+	SIM_STATS.step_index = step_index + 1;
+}
+
+void stats_write_csv_header(FILE* const file) {
+	fprintf(file,
+		"step,step_time_ms,state_hash,active_bodies,sleeping_bodies,candidate_pairs,aabb_rejects,bisection_iterations,"
+		"sat_axes_tested,sat_early_outs,gjk_iterations,epa_iterations,mesh_triangles,compound_child_pairs,manifolds,contact_points,solver_iterations,"
+		"contact_pool_overflows,manifold_overflows,contact_event_overflows\n");
+}
+
+void stats_write_csv_row(FILE* const file, const SimStats* const stats) {
+	fprintf(file, "%llu,%.4f,%016llx,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n",
+		(unsigned long long)stats->step_index,
+		stats->step_time_ms,
+		(unsigned long long)stats->state_hash,
+		stats->active_bodies,
+		stats->sleeping_bodies,
+		stats->candidate_pairs,
+		stats->aabb_rejects,
+		stats->bisection_iterations,
+		stats->sat_axes_tested,
+		stats->sat_early_outs,
+		stats->gjk_iterations,
+		stats->epa_iterations,
+		stats->mesh_triangles,
+		stats->compound_child_pairs,
+		stats->manifolds,
+		stats->contact_points,
+		stats->solver_iterations,
+		stats->contact_pool_overflows,
+		stats->manifold_overflows,
+		stats->contact_event_overflows);
+}
+
+bool stats_open_csv_log(const char* const path) {
+	stats_close_csv_log();
+
+	STATS_CSV_LOG = fopen(path, "wb");
+	if (!STATS_CSV_LOG) {
+		printf("Failed to open stats log file\n");
+		return false;
+	}
+
+	stats_write_csv_header(STATS_CSV_LOG);
+	return true;
+}
+
+void stats_close_csv_log() {
+	if (STATS_CSV_LOG) {
+		fclose(STATS_CSV_LOG);
+		STATS_CSV_LOG = NULL;
+	}
+}
+
+bool stats_csv_log_is_open() {
+	return STATS_CSV_LOG != NULL;
+}
+
+void stats_log_step() {
+	if (STATS_CSV_LOG) {
+		stats_write_csv_row(STATS_CSV_LOG, &SIM_STATS);
+	}
+}
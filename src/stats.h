@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Counters filled by physics_step, reset at the start of every step
+typedef struct {
+	uint64_t step_index;
+	double step_time_ms;
+	uint64_t state_hash; // body_state_checksum after the step, 0 unless body_state_hash_steps enabled it
+
+	int active_bodies;
+	int sleeping_bodies;
+
+	int candidate_pairs;
+	int aabb_rejects;
+	int bisection_iterations;
+	int sat_axes_tested;
+	int sat_early_outs;
+	int gjk_iterations;
+	int epa_iterations;
+	int mesh_triangles;
+	int compound_child_pairs;
+
+	int manifolds;
+	int contact_points;
+	int solver_iterations;
+
+	int contact_pool_overflows;
+	int manifold_overflows;
+	int contact_event_overflows;
+} SimStats;
+
+extern SimStats SIM_STATS;
+
+const SimStats* stats_get();
+void stats_begin_step();
+
+void stats_write_csv_header(FILE* const file);
+void stats_write_csv_row(FILE* const file, const SimStats* const stats);
+
+// Per-step CSV log, written by physics_step while open
+bool stats_open_csv_log(const char* const path);
+void stats_close_csv_log();
+bool stats_csv_log_is_open();
+void stats_log_step();
@@ -0,0 +1,101 @@
+#include "jobs.h"
+#include <stdbool.h>
+#include <windows.h>
+
+typedef struct {
+	JobFunction function;
+	void* context;
+	int count;
+	int batch_size;
+	volatile LONG next; // First item no thread has taken yet
+} Job;
+
+HANDLE JOB_WORKERS[JOBS_MAX_WORKERS];
+int NUM_JOB_WORKERS = -1; // -1 until the pool started
+HANDLE JOB_START = NULL; // Semaphore, released once for each worker that should join a job
+HANDLE JOB_DONE = NULL; // Set by the last worker to run out of items
+volatile LONG JOB_RUNNING_WORKERS = 0;
+Job JOB = {};
+
+void job_run(Job* const job) {
+	while (true) {
+		const int first = InterlockedExchangeAdd(&job->next, job->batch_size);
+		if (first >= job->count) {
+			return;
+		}
+		const int remaining = job->count - first;
+		job->function(job->context, first, remaining < job->batch_size ? remaining : job->batch_size);
+	}
+}
+
+DWORD WINAPI job_worker(LPVOID parameter) {
+	(void)parameter;
+	while (true) {
+		WaitForSingleObject(JOB_START, INFINITE);
+		job_run(&JOB);
+		if (InterlockedDecrement(&JOB_RUNNING_WORKERS) == 0) {
+			SetEvent(JOB_DONE);
+		}
+	}
+}
+
+void jobs_start() {
+	SYSTEM_INFO system_info;
+	GetSystemInfo(&system_info);
+
+	int num_workers = (int)system_info.dwNumberOfProcessors - 1;
+	if (num_workers > JOBS_MAX_WORKERS) {
+		num_workers = JOBS_MAX_WORKERS;
+	}
+
+	JOB_START = CreateSemaphore(NULL, 0, JOBS_MAX_WORKERS, NULL);
+	JOB_DONE = CreateEvent(NULL, FALSE, FALSE, NULL);
+	NUM_JOB_WORKERS = 0;
+	if (!JOB_START || !JOB_DONE) {
+		return;
+	}
+
+	// The workers live until the process exits
+	for (int i = 0; i < num_workers; i++) {
+		JOB_WORKERS[i] = CreateThread(NULL, 0, job_worker, NULL, 0, NULL);
+		if (!JOB_WORKERS[i]) {
+			break;
+		}
+		NUM_JOB_WORKERS++;
+	}
+}
+
+int jobs_num_threads() {
+	if (NUM_JOB_WORKERS < 0) {
+		jobs_start();
+	}
+	return NUM_JOB_WORKERS + 1;
+}
+
+void jobs_parallel_for(const int count, const int batch_size, const JobFunction function, void* const context) {
+	if (NUM_JOB_WORKERS < 0) {
+		jobs_start();
+	}
+
+	// Only wake as many workers as there are batches left after the caller's first one
+	const int num_batches = (count + batch_size - 1) / batch_size;
+	const int num_workers = num_batches - 1 < NUM_JOB_WORKERS ? num_batches - 1 : NUM_JOB_WORKERS;
+	if (num_workers <= 0) {
+		if (count > 0) {
+			function(context, 0, count);
+		}
+		return;
+	}
+
+	JOB.function = function;
+	JOB.context = context;
+	JOB.count = count;
+	JOB.batch_size = batch_size;
+	JOB.next = 0;
+	JOB_RUNNING_WORKERS = num_workers;
+
+	// Releasing the semaphore is a full barrier, the workers see the job written above
+	ReleaseSemaphore(JOB_START, num_workers, NULL);
+	job_run(&JOB);
+	WaitForSingleObject(JOB_DONE, INFINITE);
+}
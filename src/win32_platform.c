@@ -63,6 +63,12 @@ LRESULT CALLBACK window_proc(HWND window, UINT message, WPARAM w_param, LPARAM l
 				case '5': {
 					INPUT_BUFFER.slowmo_5x = true;
 				} break;
+				case 'P': {
+					INPUT_BUFFER.dump_profile = true;
+				} break;
+				case 'L': {
+					INPUT_BUFFER.toggle_stats_log = true;
+				} break;
 			}
 		} break;
 		case WM_LBUTTONDOWN: {
@@ -0,0 +1,79 @@
+// Records the same creates from the job threads in different splits and orders, and checks
+// that deterministic builds end up with the same world every time. Pairs of creates differ only
+// in their hull, so their order comes from order_key alone.
+
+#include "body_state.h"
+#include "command_buffer.h"
+#include "convex_hull.h"
+#include "jobs.h"
+#include "physics.h"
+#include <stdio.h>
+
+enum {
+	TEST_CREATES = 64,
+	TEST_STEPS = 120
+};
+
+ConvexHull TEST_HULLS[2];
+
+typedef struct {
+	bool reversed;
+} TestRecording;
+
+void test_record_job(void* const context, const int first, const int count) {
+	const TestRecording* const recording = context;
+	for (int k = first; k < first + count; k++) {
+		const int i = recording->reversed ? TEST_CREATES - 1 - k : k;
+		const int pair = i / 2;
+		const BodyDesc body = {
+			.shape = SHAPE_HULL,
+			.type = BODY_DYNAMIC,
+			.position = { (pair % 8) * 3.0f, 2 + (pair / 8) * 3.0f, 0 },
+			.orientation = MAT3_IDENTITY,
+			.mass = 1,
+			.hull = &TEST_HULLS[i % 2],
+			.order_key = (uint32_t)i
+		};
+		command_create(&body, NULL);
+	}
+}
+
+uint64_t test_run(const int batch_size, const bool reversed) {
+	physics_reset();
+	add_static_box((Vec3){ 0, -1, 0 }, MAT3_IDENTITY, (Vec3){ 50, 1, 50 });
+
+	TestRecording recording = { reversed };
+	jobs_parallel_for(TEST_CREATES, batch_size, test_record_job, &recording);
+
+	for (int step = 0; step < TEST_STEPS; step++) {
+		physics_step();
+	}
+	return body_state_checksum();
+}
+
+int main() {
+	const Vec3 box[] = {
+		{ -1, -1, -1 }, { 1, -1, -1 }, { -1, 1, -1 }, { 1, 1, -1 },
+		{ -1, -1, 1 }, { 1, -1, 1 }, { -1, 1, 1 }, { 1, 1, 1 }
+	};
+	const Vec3 tetrahedron[] = { { 0, 0.8f, 0 }, { -0.6f, -0.4f, -0.5f }, { 0.6f, -0.4f, -0.5f }, { 0, -0.4f, 0.7f } };
+	convex_hull_build(&TEST_HULLS[0], box, 8);
+	convex_hull_build(&TEST_HULLS[1], tetrahedron, 4);
+
+	const int batch_sizes[] = { 1, 3, 16, TEST_CREATES };
+	const uint64_t expected = test_run(TEST_CREATES, false);
+	int failures = 0;
+
+	for (int i = 0; i < (int)(sizeof(batch_sizes) / sizeof(batch_sizes[0])); i++) {
+		for (int reversed = 0; reversed < 2; reversed++) {
+			const uint64_t checksum = test_run(batch_sizes[i], reversed);
+			if (checksum != expected) {
+				printf("Batch size %d%s: checksum %016llx, expected %016llx\n", batch_sizes[i], reversed ? " reversed" : "", (unsigned long long)checksum, (unsigned long long)expected);
+				failures++;
+			}
+		}
+	}
+
+	printf("%s on %d threads\n", failures == 0 ? "Passed" : "Failed", jobs_num_threads());
+	return failures == 0 ? 0 : 1;
+}